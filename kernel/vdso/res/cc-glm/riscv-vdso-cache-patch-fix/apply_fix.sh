@@ -49,6 +49,14 @@ fi
 # Apply the fix
 patch -p1 < "$PATCH_DIR/0001-riscv-vdso-fix-time-cache-use-TLS-instead-of-VVAR-write.patch"
 
+# Follow-up patches on top of the TLS cache, in order
+# (0002 is the quick-disable note, not a patch)
+for p in "$PATCH_DIR"/000[3-9]-*.patch "$PATCH_DIR"/00[1-9][0-9]-*.patch; do
+    [ -f "$p" ] || continue
+    echo "  Applying $(basename "$p")"
+    patch -p1 < "$p"
+done
+
 echo ""
 echo "Step 4: Verifying the fix..."
 if grep -q "__vdso_time_cache_tls" arch/riscv/include/asm/vdso/gettimeofday.h; then
@@ -4,9 +4,13 @@
  *
  * This program measures the performance improvement from VDSO time caching
  * by comparing clock_gettime() call rates with and without caching.
+ * It builds on any architecture (see vdso_timing.h) and reports every
+ * figure in ns as well, so runs from x86_64, arm64 and RISC-V line up.
  *
- * Build: gcc -O2 -o vdso_cache_benchmark vdso_cache_benchmark.c -lrt
- * Run:   ./vdso_cache_benchmark
+ * Build: gcc -O2 -I../test -o vdso_cache_benchmark vdso_cache_benchmark.c -lrt
+ * Run:   ./vdso_cache_benchmark [--json FILE | --csv FILE]
+ *        ./vdso_cache_benchmark --jitter [--jitter-cpu N]   (gap timeline only)
+ *        ./vdso_cache_benchmark --virt [--virt-baseline HOST.jsonl]
  */
 
 #define _GNU_SOURCE
@@ -16,22 +20,37 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <pthread.h>
 #include <sys/syscall.h>
 #include <linux/time_types.h>
 
-/* RISC-V cycle counter access */
-static inline uint64_t rdcycle(void)
-{
-    uint64_t cycles;
-    asm volatile("rdcycle %0" : "=r"(cycles));
-    return cycles;
-}
+#include "vdso_hist.h"
+#include "vdso_results.h"
+#include "vdso_calib.h"
+#include "vdso_timing.h"
+#include "vdso_breakdown.h"
+#include "vdso_multi.h"
+#include "vdso_hybrid.h"
+#include "vdso_cache_stats.h"
+#include "vdso_perf.h"
+#include "vdso_replay.h"
+#include "vdso_jitter.h"
+#include "vdso_clocks.h"
+#include "vdso_virt.h"
+#include "vdso_time_path.h"
+#include "vdso_ustime.h"
+
+/* --ustime: measure the user-space timestamp source (vdso_ustime.h) instead */
+static bool use_ustime;
+
+/* Direct VDSO call, resolved by vdso_timing_vdso_gettime() in main() */
+static int (*vdso_gettime)(clockid_t clk, struct timespec *ts) = clock_gettime;
 
-/* Direct VDSO call */
-extern int __vdso_clock_gettime(clockid_t clk, struct timespec *ts);
 int clock_gettime_vdso(clockid_t clk, struct timespec *ts)
 {
-    return __vdso_clock_gettime(clk, ts);
+    if (use_ustime)
+        return vdso_ustime_gettime(clk, ts);
+    return vdso_gettime(clk, ts);
 }
 
 /* System call version (for comparison) */
@@ -45,6 +64,7 @@ struct benchmark_config {
     int iterations;
     int warmup_iterations;
     const char *name;
+    clockid_t clock;
 };
 
 /* Benchmark result */
@@ -56,8 +76,13 @@ struct benchmark_result {
     double avg_cycles;
     double calls_per_sec;
     int iterations;
+    struct vdso_hist *hist;     /* Per-call latency distribution (cycles) */
+    struct vdso_perf_counts perf;   /* Counted over the timed loop */
 };
 
+/* Thread-wide perf counters, opened in main(); entries stay -1 if absent */
+static struct vdso_perf perf = { .fd = { -1, -1, -1 } };
+
 /* Run benchmark */
 static struct benchmark_result run_benchmark(
     int (*fn)(clockid_t, struct timespec *),
@@ -68,25 +93,36 @@ static struct benchmark_result run_benchmark(
     uint64_t total = 0;
     uint64_t min = UINT64_MAX;
     uint64_t max = 0;
+    struct vdso_hist *hist = vdso_hist_alloc();
     int i;
 
+    if (!hist) {
+        perror("vdso_hist_alloc");
+        exit(1);
+    }
+
     /* Warmup */
     for (i = 0; i < cfg->warmup_iterations; i++) {
-        fn(CLOCK_MONOTONIC, &ts);
+        fn(cfg->clock, &ts);
     }
 
     /* Actual benchmark */
+    vdso_perf_begin(&perf);
     for (i = 0; i < cfg->iterations; i++) {
-        start = rdcycle();
-        fn(CLOCK_MONOTONIC, &ts);
-        end = rdcycle();
+        start = vdso_timing_read();
+        fn(cfg->clock, &ts);
+        end = vdso_timing_read();
 
         elapsed = end - start;
         total += elapsed;
 
         if (elapsed < min) min = elapsed;
         if (elapsed > max) max = elapsed;
+        vdso_hist_record(hist, elapsed);
     }
+    struct vdso_perf_counts pc;
+
+    vdso_perf_end(&perf, &pc);
 
     struct benchmark_result result = {
         .name = cfg->name,
@@ -96,18 +132,13 @@ static struct benchmark_result run_benchmark(
         .avg_cycles = (double)total / cfg->iterations,
         .calls_per_sec = 0.0,
         .iterations = cfg->iterations,
+        .hist = hist,
+        .perf = pc,
     };
 
-    /* Estimate calls per second based on CPU frequency */
-    FILE *fp = fopen("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq", "r");
-    if (fp) {
-        unsigned long freq_khz;
-        if (fscanf(fp, "%lu", &freq_khz) == 1) {
-            double freq_mhz = freq_khz / 1000.0;
-            result.calls_per_sec = (freq_mhz * 1000000.0) / result.avg_cycles;
-        }
-        fclose(fp);
-    }
+    /* Calls per second from the calibrated cycle rate of this hart */
+    vdso_calib_refresh();
+    result.calls_per_sec = vdso_cycles_to_rate(result.avg_cycles);
 
     return result;
 }
@@ -116,24 +147,53 @@ static struct benchmark_result run_benchmark(
 static void print_result(const struct benchmark_result *r,
                         const struct benchmark_result *baseline)
 {
+    unsigned int i;
+    char scope[64];
+
+    vdso_results_slug(scope, sizeof(scope), r->name);
+    vdso_results_scope(scope, r->iterations);
+    vdso_results_emit("avg cycles", r->avg_cycles, "cycles", -1);
+    vdso_results_emit("min cycles", r->min_cycles, "cycles", -1);
+    vdso_results_emit("max cycles", r->max_cycles, "cycles", -1);
+    if (r->calls_per_sec > 0)
+        vdso_results_emit("calls per sec", r->calls_per_sec, "calls/sec", -1);
+    for (i = 0; i < VDSO_HIST_NR_PERCENTILES; i++) {
+        char name[32];
+
+        snprintf(name, sizeof(name), "latency p%g", vdso_hist_percentiles[i]);
+        vdso_results_emit(name,
+                          vdso_hist_percentile(r->hist, vdso_hist_percentiles[i]),
+                          "cycles", -1);
+    }
+
     printf("\n");
     printf("=== %s ===\n", r->name);
     printf("  Iterations:      %d\n", r->iterations);
     printf("  Total cycles:    %lu\n", r->total_cycles);
     printf("  Avg cycles/call: %.2f\n", r->avg_cycles);
-    printf("  Min cycles:      %lu\n", r->min_cycles);
-    printf("  Max cycles:      %lu\n", r->max_cycles);
+    printf("  Avg ns/call:     %.2f\n", vdso_cycles_to_ns(r->avg_cycles));
+    printf("  Min cycles:      %lu (%.1f ns)\n", r->min_cycles,
+           vdso_cycles_to_ns((double)r->min_cycles));
+    printf("  Max cycles:      %lu (%.1f ns)\n", r->max_cycles,
+           vdso_cycles_to_ns((double)r->max_cycles));
 
     if (r->calls_per_sec > 0) {
         printf("  Est. calls/sec: %.0f\n", r->calls_per_sec);
     }
 
+    vdso_perf_report(&r->perf, r->iterations, "  ");
+    printf("  Latency percentiles:\n");
+    vdso_hist_print_percentiles(r->hist, "    ", "cycles", vdso_cycles_to_ns(1.0));
+    printf("  Latency distribution (cycles):\n");
+    vdso_hist_print_buckets(r->hist, "    ");
+
     if (baseline) {
         double improvement = ((baseline->avg_cycles - r->avg_cycles) /
                              baseline->avg_cycles) * 100.0;
         double speedup = baseline->avg_cycles / r->avg_cycles;
         printf("  vs baseline:     %.1f%% faster (%.2fx speedup)\n",
                improvement, speedup);
+        vdso_results_emit("speedup vs baseline", speedup, "x", -1);
     }
 }
 
@@ -147,13 +207,16 @@ static void simulate_ai_inference(int iterations)
     printf("\n=== AI Inference Simulation ===\n");
     printf("Simulating %d inference iterations with timing...\n", iterations);
 
+    struct vdso_perf_counts pc;
+
+    vdso_perf_begin(&perf);
     for (int i = 0; i < iterations; i++) {
-        start = rdcycle();
+        start = vdso_timing_read();
         clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
         /* Simulate inference work (delay) */
         usleep(10); /* 10 microseconds */
         clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
-        end = rdcycle();
+        end = vdso_timing_read();
 
         uint64_t latency = end - start;
         total_latency += latency;
@@ -163,40 +226,671 @@ static void simulate_ai_inference(int iterations)
         }
     }
 
-    printf("\nAverage latency per inference: %.2f cycles\n",
-           (double)total_latency / iterations);
+    vdso_perf_end(&perf, &pc);
+
+    printf("\nAverage latency per inference: %.2f cycles (%.2f ns)\n",
+           (double)total_latency / iterations,
+           vdso_cycles_to_ns((double)total_latency / iterations));
+
+    vdso_results_scope("ai_inference", iterations);
+    vdso_results_emit("avg latency", (double)total_latency / iterations,
+                      "cycles", -1);
+    /* usleep() is in the window, so traps include the kernel's own reads */
+    vdso_perf_report(&pc, 2 * iterations, "");
 }
 
 /* Cache hit rate test */
 static void test_cache_hit_rate(int test_duration_sec)
 {
     struct timespec ts;
+    struct vdso_cache_stats start, end, d, sum = { 0 };
     uint64_t hit_count = 0;
     uint64_t total_count = 0;
     time_t start_time = time(NULL);
+    bool exact = vdso_cache_stats_available();
 
     printf("\n=== Cache Hit Rate Test (%d seconds) ===\n", test_duration_sec);
+    if (!exact)
+        printf("  __vdso_time_cache_stats not exported, estimating hits from latency\n");
 
     while (time(NULL) - start_time < test_duration_sec) {
+        /* Snapshot around the burst only: calibration below also reads clocks */
+        exact = exact && vdso_cache_stats_read(&start);
+
         /* Rapid consecutive calls - should hit cache */
         for (int i = 0; i < 100; i++) {
-            uint64_t t1 = rdcycle();
+            uint64_t t1 = vdso_timing_read();
             clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
-            uint64_t t2 = rdcycle();
+            uint64_t t2 = vdso_timing_read();
 
             total_count++;
-            /* If call took < 100 cycles, assume cache hit */
+            /* Without exact counters, a call under 100 cycles counts as a hit */
             if (t2 - t1 < 100) {
                 hit_count++;
             }
         }
+
+        if (exact && vdso_cache_stats_read(&end)) {
+            vdso_cache_stats_delta(&start, &end, &d);
+            sum.hits += d.hits;
+            sum.misses += d.misses;
+            sum.invalidations += d.invalidations;
+        }
         usleep(1000); /* 1ms delay */
+        vdso_calib_refresh();
+    }
+
+    if (exact) {
+        total_count = sum.hits + sum.misses;
+        hit_count = sum.hits;
     }
 
-    double hit_rate = (double)hit_count / total_count * 100.0;
+    double hit_rate = total_count ? (double)hit_count / total_count * 100.0 : 0.0;
     printf("  Total calls: %lu\n", total_count);
-    printf("  Cache hits:  %lu\n", hit_count);
+    printf("  Cache hits:  %lu%s\n", hit_count, exact ? "" : " (estimated)");
+    if (exact) {
+        printf("  Misses:      %lu\n", (unsigned long)sum.misses);
+        printf("  Invalidations: %lu\n", (unsigned long)sum.invalidations);
+    }
     printf("  Hit rate:    %.2f%%\n", hit_rate);
+
+    vdso_results_scope("cache_hit_rate", total_count);
+    vdso_results_emit("exact counters", exact, "bool", -1);
+    vdso_results_emit("hit rate", hit_rate, "%", -1);
+    if (exact) {
+        vdso_results_emit("misses", sum.misses, "count", -1);
+        vdso_results_emit("invalidations", sum.invalidations, "count", -1);
+    }
+}
+
+/*
+ * Multi-clock sample: read several clocks back to back, once with one
+ * clock_gettime() per clock and once through the batched vDSO entry.
+ * Traps per sample come from the SBI firmware counter (vdso_perf.h), in a
+ * separate pass per variant so that the timed loop stays interleaved.
+ * Without that counter, counter reads per sample are estimated from the
+ * cost attribution: N for the per-clock loop without cache hits, 1 for
+ * the batch.
+ */
+static void test_multi_clock(const struct vdso_breakdown *bd, int iterations)
+{
+    static const clockid_t clocks[] = {
+        CLOCK_REALTIME, CLOCK_MONOTONIC, CLOCK_BOOTTIME, CLOCK_MONOTONIC_RAW,
+    };
+    const unsigned int n = sizeof(clocks) / sizeof(clocks[0]);
+    struct timespec ts[sizeof(clocks) / sizeof(clocks[0])];
+    uint64_t each_cycles = 0, multi_cycles = 0;
+    double each_avg, multi_avg, each_reads, multi_reads;
+    struct vdso_perf_counts each_pc, multi_pc;
+    bool batched = vdso_multi_available(), counted;
+
+    printf("\n=== Multi-Clock Sample (%u clocks) ===\n", n);
+    if (!batched)
+        printf("  __vdso_clock_gettime_multi not exported, shim falls back to a loop\n");
+
+    for (int i = 0; i < iterations; i++) {
+        uint64_t t0 = vdso_timing_read();
+        for (unsigned int c = 0; c < n; c++)
+            clock_gettime_vdso(clocks[c], &ts[c]);
+        uint64_t t1 = vdso_timing_read();
+        vdso_clock_gettime_multi(clocks, ts, n);
+        uint64_t t2 = vdso_timing_read();
+
+        each_cycles += t1 - t0;
+        multi_cycles += t2 - t1;
+    }
+
+    vdso_perf_begin(&perf);
+    for (int i = 0; i < iterations; i++) {
+        for (unsigned int c = 0; c < n; c++)
+            clock_gettime_vdso(clocks[c], &ts[c]);
+    }
+    vdso_perf_end(&perf, &each_pc);
+    vdso_perf_begin(&perf);
+    for (int i = 0; i < iterations; i++)
+        vdso_clock_gettime_multi(clocks, ts, n);
+    vdso_perf_end(&perf, &multi_pc);
+    counted = each_pc.valid[VDSO_PERF_TRAPS] && multi_pc.valid[VDSO_PERF_TRAPS];
+
+    each_avg = (double)each_cycles / iterations;
+    multi_avg = (double)multi_cycles / iterations;
+    if (counted) {
+        each_reads = (double)each_pc.value[VDSO_PERF_TRAPS] / iterations;
+        multi_reads = (double)multi_pc.value[VDSO_PERF_TRAPS] / iterations;
+    } else {
+        each_reads = vdso_breakdown_reads(bd, each_avg,
+                                          n * vdso_breakdown_software(bd), n);
+        /* The batch pays one call, dispatch and seqlock pass, then per-clock math */
+        multi_reads = vdso_breakdown_reads(bd, multi_avg,
+                                           bd->null_call + bd->dispatch + bd->seqlock +
+                                           n * (bd->mult_shift + bd->ts_conv), n);
+    }
+
+    printf("  Per-clock calls: %8.2f cycles/sample (%.2f ns), %.2f %s/sample\n",
+           each_avg, vdso_cycles_to_ns(each_avg), each_reads,
+           counted ? "traps" : "estimated counter reads");
+    printf("  Batched read:    %8.2f cycles/sample (%.2f ns), %.2f %s/sample\n",
+           multi_avg, vdso_cycles_to_ns(multi_avg), multi_reads,
+           counted ? "traps" : "estimated counter reads");
+    printf("  Speedup:         %.2fx\n", each_avg / multi_avg);
+
+    vdso_results_scope("multi_clock", iterations);
+    vdso_results_emit("batched available", batched, "bool", -1);
+    vdso_results_emit("per clock cycles", each_avg, "cycles", -1);
+    vdso_results_emit("batched cycles", multi_avg, "cycles", -1);
+    if (counted) {
+        vdso_results_emit("per clock traps", each_reads, "traps", -1);
+        vdso_results_emit("batched traps", multi_reads, "traps", -1);
+    } else {
+        vdso_results_emit("per clock reads estimated", each_reads, "reads", -1);
+        vdso_results_emit("batched reads estimated", multi_reads, "reads", -1);
+    }
+}
+
+/*
+ * Hybrid clock vs the cached path: the cached clock_gettime() traps on
+ * every miss, the hybrid entry never traps but pays an rdcycle and the
+ * interpolation. Also reports how far apart the two clocks read.
+ */
+static void test_hybrid_clock(const struct vdso_breakdown *bd, int iterations)
+{
+    struct timespec a, b;
+    uint64_t cached_cycles = 0, hybrid_cycles = 0;
+    int64_t max_skew = 0;
+    double cached_avg, hybrid_avg;
+    bool hybrid = vdso_hybrid_available();
+
+    printf("\n=== Hybrid Clock vs Cached ===\n");
+    if (!hybrid)
+        printf("  __vdso_clock_gettime_hybrid not exported, shim falls back to clock_gettime\n");
+
+    for (int i = 0; i < iterations; i++) {
+        uint64_t t0 = vdso_timing_read();
+        clock_gettime_vdso(CLOCK_MONOTONIC, &a);
+        uint64_t t1 = vdso_timing_read();
+        vdso_clock_gettime_hybrid(CLOCK_MONOTONIC, &b);
+        uint64_t t2 = vdso_timing_read();
+        int64_t skew = (int64_t)(b.tv_sec - a.tv_sec) * 1000000000LL +
+                       (b.tv_nsec - a.tv_nsec);
+
+        cached_cycles += t1 - t0;
+        hybrid_cycles += t2 - t1;
+        if (skew < 0)
+            skew = -skew;
+        if (skew > max_skew)
+            max_skew = skew;
+    }
+
+    cached_avg = (double)cached_cycles / iterations;
+    hybrid_avg = (double)hybrid_cycles / iterations;
+
+    printf("  Cached clock_gettime: %8.2f cycles/call (%.2f ns), ~%.2f counter reads/call\n",
+           cached_avg, vdso_cycles_to_ns(cached_avg), vdso_breakdown_reads(bd, cached_avg, vdso_breakdown_software(bd), 1));
+    printf("  Hybrid clock:         %8.2f cycles/call (%.2f ns)\n",
+           hybrid_avg, vdso_cycles_to_ns(hybrid_avg));
+    printf("  Speedup:              %.2fx\n", cached_avg / hybrid_avg);
+    printf("  Max skew between the two: %ld ns\n", (long)max_skew);
+
+    vdso_results_scope("hybrid_clock", iterations);
+    vdso_results_emit("hybrid available", hybrid, "bool", -1);
+    vdso_results_emit("cached cycles", cached_avg, "cycles", -1);
+    vdso_results_emit("hybrid cycles", hybrid_avg, "cycles", -1);
+    vdso_results_emit("max skew", max_skew, "ns", -1);
+}
+
+/* Multi-thread hit rate: TLS vs per-process shared cache */
+#define HIT_RATE_DURATION_NS    500000000ULL    /* per thread count */
+#define HIT_RATE_GAP_NS         1000            /* "work" between calls */
+#define HIT_RATE_MAX_THREADS    64
+
+struct hit_rate_worker {
+    pthread_t thread;
+    pthread_barrier_t *barrier;
+    int *gate;                  /* 0 wait, 1 run */
+    bool exact;                 /* hits from __vdso_time_cache_stats */
+    uint64_t threshold;         /* cycles; else faster calls count as hits */
+    uint64_t gap;               /* cycles of work between calls */
+    uint64_t duration;          /* cycles */
+    uint64_t calls;
+    uint64_t hits;
+};
+
+static void *hit_rate_thread(void *arg)
+{
+    struct hit_rate_worker *w = arg;
+    struct vdso_cache_stats s0, s1;
+    struct timespec ts;
+    uint64_t start, now, t0, t1;
+
+    /* The barrier is sized once the number of started threads is known */
+    while (__atomic_load_n(w->gate, __ATOMIC_ACQUIRE) == 0)
+        sched_yield();
+    pthread_barrier_wait(w->barrier);
+    w->exact = w->exact && vdso_cache_stats_read(&s0);
+    start = vdso_timing_read();
+    do {
+        t0 = vdso_timing_read();
+        clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
+        t1 = vdso_timing_read();
+
+        w->calls++;
+        if (!w->exact && t1 - t0 < w->threshold)
+            w->hits++;
+
+        do {
+            now = vdso_timing_read();
+        } while (now - t1 < w->gap);
+    } while (now - start < w->duration);
+
+    /* The counters are per thread and only this loop called the vDSO */
+    if (w->exact && vdso_cache_stats_read(&s1)) {
+        w->calls = s1.hits + s1.misses - s0.hits - s0.misses;
+        w->hits = s1.hits - s0.hits;
+    } else {
+        w->exact = false;
+    }
+    return NULL;
+}
+
+/* "tls", "shared" or "off", from the running kernel's config */
+static const char *time_cache_mode(void)
+{
+    char val[16];
+
+    if (vdso_kconfig_get("CONFIG_RISCV_VDSO_TIME_CACHE_SHARED", val, sizeof(val)) &&
+        strcmp(val, "y") == 0)
+        return "shared";
+    if (vdso_kconfig_get("CONFIG_RISCV_VDSO_TIME_CACHE", val, sizeof(val)) &&
+        strcmp(val, "y") == 0)
+        return "tls";
+    return "off";
+}
+
+/*
+ * Worker threads call clock_gettime() with ~1us of work in between, like
+ * OpenMP workers stamping loop iterations. Hits come from the vDSO's own
+ * counters when __vdso_time_cache_stats is exported; otherwise a call
+ * faster than halfway between a hit and a trap counts as a hit and the
+ * rates are marked as estimates. With TLS every thread misses
+ * once per timekeeping update; with the shared page the whole process
+ * does. Run on both kernels to compare the two modes.
+ */
+static void test_thread_hit_rate(const struct vdso_breakdown *bd, int max_threads)
+{
+    const char *mode = time_cache_mode();
+    struct hit_rate_worker *workers;
+    pthread_barrier_t barrier;
+    double cycles_per_ns = vdso_calib_freq_mhz() / 1000.0;
+    bool exact = vdso_cache_stats_available();
+    char scope[64];
+
+    printf("\n=== Multi-Thread Cache Hit Rate (mode: %s) ===\n", mode);
+    if (!exact)
+        printf("  __vdso_time_cache_stats not exported, estimating hits from latency\n");
+    if (max_threads > HIT_RATE_MAX_THREADS)
+        max_threads = HIT_RATE_MAX_THREADS;
+
+    workers = calloc(max_threads, sizeof(*workers));
+    if (!workers) {
+        perror("calloc");
+        return;
+    }
+
+    printf("  %8s %12s %10s %16s\n", "Threads", "Calls", "Hit rate", "Misses/thread/s");
+    /* Powers of two, then @max_threads itself if it is not one */
+    for (int want = 1; want <= max_threads;
+         want = want < max_threads && want * 2 > max_threads ? max_threads : want * 2) {
+        uint64_t calls = 0, hits = 0;
+        double secs = HIT_RATE_DURATION_NS / 1e9;
+        int gate = 0, nr;
+
+        for (nr = 0; nr < want; nr++) {
+            workers[nr] = (struct hit_rate_worker) {
+                .barrier = &barrier,
+                .gate = &gate,
+                .exact = exact,
+                .threshold = (uint64_t)(vdso_breakdown_software(bd) + bd->counter / 2),
+                .gap = (uint64_t)(HIT_RATE_GAP_NS * cycles_per_ns),
+                .duration = (uint64_t)(HIT_RATE_DURATION_NS * cycles_per_ns),
+            };
+            if (pthread_create(&workers[nr].thread, NULL, hit_rate_thread,
+                               &workers[nr]) != 0) {
+                perror("pthread_create");
+                break;
+            }
+        }
+        if (!nr)
+            break;
+        pthread_barrier_init(&barrier, NULL, nr);
+        __atomic_store_n(&gate, 1, __ATOMIC_RELEASE);
+        for (int i = 0; i < nr; i++) {
+            pthread_join(workers[i].thread, NULL);
+            calls += workers[i].calls;
+            hits += workers[i].hits;
+            exact = exact && workers[i].exact;
+        }
+        pthread_barrier_destroy(&barrier);
+
+        double hit_rate = calls ? (double)hits / calls * 100.0 : 0.0;
+        double misses = (double)(calls - hits) / nr / secs;
+
+        printf("  %8d %12lu %9.2f%% %16.0f%s\n", nr, (unsigned long)calls,
+               hit_rate, misses, exact ? "" : " (estimated)");
+
+        snprintf(scope, sizeof(scope), "thread_hit_rate.%s.t%d", mode, nr);
+        vdso_results_scope(scope, calls);
+        vdso_results_emit("exact counters", exact, "bool", -1);
+        vdso_results_emit("hit rate", hit_rate, "%", -1);
+        vdso_results_emit("misses per thread per sec", misses, "1/s", -1);
+    }
+
+    free(workers);
+}
+
+/*
+ * Workload replay: the gap model across OpenMP-style threads, once as
+ * booted and once with one extra counter read per call. On a kernel with
+ * the time cache that extra read is the trap a miss would take, so the
+ * second run stands in for "cache off" without rebooting. On a kernel
+ * without the cache only the first run is meaningful.
+ */
+#define REPLAY_DURATION_NS      500000000ULL    /* gap time per run; barriers add to it */
+
+static void test_replay(const struct vdso_breakdown *bd, const char *spec,
+                        int threads, int calls_per_barrier)
+{
+    static const char *const runs[] = { "on", "off" };
+    const char *mode = time_cache_mode();
+    struct vdso_replay_model model;
+    struct vdso_replay_result res[2];
+    char scope[64];
+
+    printf("\n=== Workload Replay (mode: %s) ===\n", mode);
+    if (vdso_replay_parse(&model, spec,
+                          vdso_cycles_to_ns(vdso_breakdown_uncached(bd))) < 0)
+        return;
+    printf("  Gap model: %s\n", model.desc);
+    printf("  %d threads, barrier every %d calls\n", threads, calls_per_barrier);
+    if (strcmp(mode, "off") == 0)
+        printf("  Time cache not enabled: \"on\" is the uncached kernel, \"off\" adds a read\n");
+
+    printf("  %6s %12s %14s %14s\n", "Cache", "Calls", "Calls/sec", "Regions/sec");
+    for (int i = 0; i < 2; i++) {
+        struct vdso_replay_config cfg = {
+            .threads = threads,
+            .calls_per_barrier = calls_per_barrier,
+            .duration_ns = REPLAY_DURATION_NS,
+            .gettime = clock_gettime_vdso,
+            .force_counter_read = i == 1,
+        };
+
+        if (vdso_replay_run(&model, &cfg, &res[i]) < 0) {
+            printf("  replay failed (calibration or thread count)\n");
+            vdso_replay_free(&model);
+            return;
+        }
+        printf("  %6s %12lu %14.0f %14.0f\n", runs[i], (unsigned long)res[i].calls,
+               res[i].calls_per_sec, res[i].regions_per_sec);
+
+        snprintf(scope, sizeof(scope), "replay.%s.%s", mode, runs[i]);
+        vdso_results_scope(scope, res[i].calls);
+        vdso_results_emit("calls per sec", res[i].calls_per_sec, "calls/sec", -1);
+        vdso_results_emit("regions per sec", res[i].regions_per_sec, "1/s", -1);
+        vdso_results_emit("seconds", res[i].seconds, "s", -1);
+    }
+
+    if (res[0].seconds > 0) {
+        double speedup = res[1].seconds / res[0].seconds;
+
+        printf("  End-to-end speedup: %.3fx\n", speedup);
+        vdso_results_emit("end to end speedup", speedup, "x", -1);
+    }
+    vdso_replay_free(&model);
+}
+
+/*
+ * Jitter mode: back-to-back calls on one pinned hart, with every gap over
+ * the threshold attributed to what the hart did meanwhile. Meant for a
+ * hart booted with isolcpus= / nohz_full=, where anything left is the
+ * time path itself or firmware.
+ */
+static void test_jitter(int cpu, double threshold_ns, double duration_s)
+{
+    struct vdso_jitter_config cfg = {
+        .cpu = cpu,
+        .threshold_ns = threshold_ns,
+        .duration_ns = duration_s * 1e9,
+        .gettime = clock_gettime_vdso,
+        .trap_fd = perf.fd[VDSO_PERF_TRAPS],
+        .hist = vdso_hist_alloc(),
+    };
+    struct vdso_jitter_result *res = calloc(1, sizeof(*res));
+    char scope[64];
+
+    printf("\n=== Jitter (hart %d, threshold %.0f ns, %.0f s) ===\n",
+           cpu, threshold_ns, duration_s);
+    if (!res || !cfg.hist) {
+        perror("calloc");
+        goto out;
+    }
+    if (cpu != vdso_jitter_isolated_cpu())
+        printf("  hart %d is not isolated (isolcpus=): expect scheduler noise\n", cpu);
+    if (vdso_jitter_run(&cfg, res) < 0) {
+        printf("  cannot pin to or calibrate hart %d\n", cpu);
+        goto out;
+    }
+
+    printf("  %10s %10s %6s %6s %5s %6s %6s  %s\n",
+           "Time(ms)", "Gap(us)", "IRQs", "Timer", "CSW", "Traps", "Inval", "Cause");
+    for (size_t i = 0; i < res->nr_stored; i++) {
+        const struct vdso_jitter_gap *g = &res->gaps[i];
+        char traps[24] = "-", inval[24] = "-";
+
+        if (res->has_traps)
+            snprintf(traps, sizeof(traps), "%lu", (unsigned long)g->d.traps);
+        if (res->has_inval)
+            snprintf(inval, sizeof(inval), "%lu", (unsigned long)g->d.inval);
+        printf("  %10.3f %10.2f %6lu %6lu %5lu %6s %6s  %s\n",
+               g->t_ns / 1e6, g->gap_ns / 1e3, (unsigned long)g->d.irqs,
+               (unsigned long)g->d.timer, (unsigned long)g->d.csw, traps, inval,
+               vdso_jitter_causes[g->cause]);
+    }
+    if (res->nr_gaps > res->nr_stored)
+        printf("  ... %lu more gaps not shown\n",
+               (unsigned long)(res->nr_gaps - res->nr_stored));
+    if (!res->has_irqs)
+        printf("  /proc/interrupts has no column for hart %d\n", cpu);
+
+    printf("\n  Calls: %lu in %.2f s, gaps: %lu (%.1f/s), max gap: %.2f us\n",
+           (unsigned long)res->calls, res->seconds, (unsigned long)res->nr_gaps,
+           res->seconds > 0 ? res->nr_gaps / res->seconds : 0.0, res->max_gap_ns / 1e3);
+    printf("  Call-to-call cycles:\n");
+    vdso_hist_print_percentiles(cfg.hist, "    ", "cycles", vdso_cycles_to_ns_hart(1.0, cpu));
+    printf("  By cause:");
+    for (int c = 0; c < VDSO_JITTER_NR_CAUSES; c++)
+        printf(" %s %lu", vdso_jitter_causes[c], (unsigned long)res->by_cause[c]);
+    printf("\n");
+
+    snprintf(scope, sizeof(scope), "jitter.cpu%d", cpu);
+    vdso_results_scope(scope, res->calls);
+    vdso_results_emit("gaps", res->nr_gaps, "count", -1);
+    vdso_results_emit("gaps per sec", res->seconds > 0 ? res->nr_gaps / res->seconds : 0,
+                      "1/s", -1);
+    vdso_results_emit("max gap", res->max_gap_ns, "ns", -1);
+    vdso_results_emit("p99.99 call to call",
+                      vdso_cycles_to_ns_hart((double)vdso_hist_percentile(cfg.hist, 99.99), cpu),
+                      "ns", -1);
+    for (int c = 0; c < VDSO_JITTER_NR_CAUSES; c++) {
+        char name[32];
+
+        snprintf(name, sizeof(name), "gaps %s", vdso_jitter_causes[c]);
+        vdso_results_emit(name, res->by_cause[c], "count", -1);
+    }
+
+out:
+    vdso_hist_free(cfg.hist);
+    free(res);
+}
+
+/*
+ * Every clock ID the vDSO serves. The five high resolution clocks read the
+ * counter through the cache (MONOTONIC_RAW from the other clock_data
+ * base); the coarse ones never trap and show the floor.
+ */
+static void test_clock_ids(int iterations)
+{
+    printf("\n=== Per-Clock vDSO Cost ===\n");
+    printf("  %-18s %10s %10s %10s %10s %14s\n",
+           "Clock", "Avg cyc", "Avg ns", "p50 ns", "p99 ns", "Calls/sec");
+    for (unsigned int c = 0; c < VDSO_NR_CLOCK_IDS; c++) {
+        const struct vdso_clock_id *clk = &vdso_clock_ids[c];
+        struct benchmark_config cfg = {
+            .iterations = iterations,
+            .warmup_iterations = iterations / 100,
+            .name = clk->name,
+            .clock = clk->id,
+        };
+        struct benchmark_result r = run_benchmark(clock_gettime_vdso, &cfg);
+        char scope[48];
+
+        printf("  %-18s %10.2f %10.2f %10.2f %10.2f %14.0f\n", clk->name, r.avg_cycles,
+               vdso_cycles_to_ns(r.avg_cycles),
+               vdso_cycles_to_ns((double)vdso_hist_percentile(r.hist, 50.0)),
+               vdso_cycles_to_ns((double)vdso_hist_percentile(r.hist, 99.0)),
+               r.calls_per_sec);
+
+        snprintf(scope, sizeof(scope), "clock.%s", clk->name);
+        vdso_results_scope(scope, r.iterations);
+        vdso_results_emit("avg cycles", r.avg_cycles, "cycles", -1);
+        vdso_results_emit("latency p99", vdso_hist_percentile(r.hist, 99.0), "cycles", -1);
+        vdso_results_emit("calls per sec", r.calls_per_sec, "calls/sec", -1);
+        vdso_hist_free(r.hist);
+    }
+}
+
+/*
+ * Which time path each hart gets: the kernel classes every hart's CSR_TIME
+ * as native or emulated and the vDSO bypasses the cache only while all
+ * online harts are native. On a mixed SoC the table shows which harts
+ * hold the direct path back. "measured" is this run's own read cost.
+ */
+static void test_time_path(void)
+{
+    static struct vdso_time_path_hart harts[VDSO_TIME_PATH_MAX_HARTS];
+    int selected = vdso_time_path_selected();
+    int n = vdso_time_path_probe(harts, VDSO_TIME_PATH_MAX_HARTS);
+    bool all_native = n > 0;
+
+    printf("\n=== Time Path per Hart ===\n");
+    printf("  %-5s %-22s %10s %-10s %-10s %-8s\n",
+           "Hart", "mvendorid:marchid", "read cyc", "measured", "kernel", "path");
+    for (int i = 0; i < n; i++) {
+        const struct vdso_time_path_hart *h = &harts[i];
+        enum vdso_time_csr class = vdso_time_path_class(h);
+        char ids[32] = "-", scope[32];
+
+        if (h->has_ids)
+            snprintf(ids, sizeof(ids), "0x%llx:0x%llx",
+                     (unsigned long long)h->mvendorid, (unsigned long long)h->marchid);
+        all_native &= class == VDSO_TIME_CSR_NATIVE;
+        printf("  %-5d %-22s %10.1f %-10s %-10s %-8s\n", h->cpu, ids, h->read_cycles,
+               vdso_time_csr_names[h->measured],
+               h->kernel < 0 ? "n/a" : vdso_time_csr_names[vdso_time_path_class(h)],
+               class == VDSO_TIME_CSR_NATIVE ? "direct" : "cached");
+
+        snprintf(scope, sizeof(scope), "time_path.cpu%d", h->cpu);
+        vdso_results_scope(scope, VDSO_TIME_PATH_READS);
+        vdso_results_emit("read cycles", h->read_cycles, "cycles", -1);
+        vdso_results_emit("native", class == VDSO_TIME_CSR_NATIVE, "bool", -1);
+    }
+
+    vdso_results_scope("time_path", VDSO_TIME_PATH_READS);
+    if (selected < 0) {
+        printf("  __vdso_riscv_time_path not exported; a patched kernel would select %s\n",
+               all_native ? "direct CSR_TIME" : "the time cache");
+    } else {
+        printf("  Selected by the vDSO: %s\n", selected ? "direct CSR_TIME" : "time cache");
+        vdso_results_emit("direct", selected, "bool", -1);
+    }
+    if (n > 1 && !all_native && selected <= 0) {
+        int native = 0;
+
+        for (int i = 0; i < n; i++)
+            native += vdso_time_path_class(&harts[i]) == VDSO_TIME_CSR_NATIVE;
+        if (native)
+            printf("  Mixed SoC: %d of %d harts are native but keep the cache\n", native, n);
+    }
+}
+
+/*
+ * Virtualization mode: what a counter read and a vDSO call cost here, and
+ * what the cache saves per call. "Forced miss" adds one counter read per
+ * call, which on a cached kernel is what a miss costs. Run with --json on
+ * the host and pass that file as --virt-baseline in the guest to compare.
+ * Timed against CLOCK_MONOTONIC_RAW, so no rdcycle access is needed.
+ */
+static void test_virt(const char *baseline)
+{
+    static const char *const compared[] = {
+        "rdtime", "vdso call", "cache saving per call",
+    };
+    const char *mode = time_cache_mode();
+    struct vdso_virt v;
+    double rd, call, forced, saving, value[3];
+
+    vdso_virt_detect(&v);
+    printf("\n=== Virtualization (%s%s%s) ===\n", v.kind,
+           v.vendor[0] ? ", " : "", v.vendor);
+#if defined(__riscv)
+    printf("  Sstc: %s, H extension: %s\n", v.sstc ? "yes" : "no",
+           v.h_ext ? "yes" : "no");
+#endif
+    if (strcmp(v.kind, "qemu-tcg") == 0)
+        printf("  Emulated CPU: costs below do not reflect hardware\n");
+
+    rd = vdso_virt_time(0, clock_gettime_vdso);
+    call = vdso_virt_time(1, clock_gettime_vdso);
+    forced = vdso_virt_time(2, clock_gettime_vdso);
+    saving = forced - call;
+
+    printf("  %-28s %10.1f ns\n", "Counter read (rdtime)", rd);
+    printf("  %-28s %10.1f ns  (time cache: %s)\n", "vDSO clock_gettime", call, mode);
+    printf("  %-28s %10.1f ns\n", "vDSO call + forced miss", forced);
+
+    vdso_results_scope("virt", (uint64_t)VDSO_VIRT_SAMPLES * VDSO_VIRT_BATCH);
+    vdso_results_emit("guest", v.guest, "bool", -1);
+    vdso_results_emit("rdtime", rd, "ns", -1);
+    vdso_results_emit("vdso call", call, "ns", -1);
+    vdso_results_emit("forced miss call", forced, "ns", -1);
+    if (strcmp(mode, "off") == 0) {
+        printf("  Time cache not enabled: no saving to report\n");
+        return;
+    }
+    printf("  %-28s %10.1f ns (%.1f%%)\n", "Cache saving per call", saving,
+           forced > 0 ? saving / forced * 100.0 : 0.0);
+    vdso_results_emit("cache saving per call", saving, "ns", -1);
+    vdso_results_emit("cache saving", forced > 0 ? saving / forced * 100.0 : 0, "%", -1);
+
+    if (!baseline)
+        return;
+    value[0] = rd;
+    value[1] = call;
+    value[2] = saving;
+    printf("\n  %-24s %12s %12s %8s\n", "vs baseline", "this run", "baseline", "ratio");
+    for (int i = 0; i < 3; i++) {
+        char name[64], slug[48];
+        double b;
+
+        vdso_results_slug(slug, sizeof(slug), compared[i]);
+        snprintf(name, sizeof(name), "virt.%s", slug);
+        b = vdso_virt_baseline(baseline, name);
+        if (isnan(b) || b <= 0) {
+            printf("  %-24s %10.1f ns %12s %8s\n", compared[i], value[i], "n/a", "-");
+            continue;
+        }
+        printf("  %-24s %10.1f ns %9.1f ns %7.2fx\n", compared[i], value[i], b,
+               value[i] / b);
+    }
 }
 
 int main(int argc, char **argv)
@@ -205,20 +899,148 @@ int main(int argc, char **argv)
         .iterations = 1000000,
         .warmup_iterations = 10000,
         .name = "VDSO clock_gettime",
+        .clock = CLOCK_MONOTONIC,
     };
+    struct vdso_breakdown bd;
+    bool breakdown_only = false;
+    const char *replay_spec = "whisper";
+    int nproc = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int replay_threads = nproc < 4 ? nproc : 4;     /* the OMP_NUM_THREADS=4 profile */
+    int replay_barrier = 8;
+    bool jitter = false;
+    bool virt = false;
+    const char *virt_baseline = NULL;
+    int jitter_cpu = vdso_jitter_isolated_cpu();
+    double jitter_threshold = 10000;    /* ns, hwlat_detector's default */
+    double jitter_duration = 10;        /* s */
+
+    for (int i = 1; i < argc; i++) {
+        int r;
+
+        if (strcmp(argv[i], "--breakdown") == 0) {
+            breakdown_only = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_spec = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--replay-threads") == 0 && i + 1 < argc) {
+            replay_threads = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--replay-barrier") == 0 && i + 1 < argc) {
+            replay_barrier = atoi(argv[++i]);
+            continue;
+        }
+
+        if (strcmp(argv[i], "--virt") == 0) {
+            virt = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--virt-baseline") == 0 && i + 1 < argc) {
+            virt = true;
+            virt_baseline = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--ustime") == 0) {
+            use_ustime = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--jitter") == 0) {
+            jitter = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--jitter-cpu") == 0 && i + 1 < argc) {
+            jitter_cpu = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--jitter-threshold") == 0 && i + 1 < argc) {
+            jitter_threshold = atof(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--jitter-duration") == 0 && i + 1 < argc) {
+            jitter_duration = atof(argv[++i]);
+            continue;
+        }
+
+        r = vdso_results_parse_arg(argc, argv, &i, "vdso_cache_benchmark");
+        if (r < 0)
+            return 2;
+        if (r == 0) {
+            printf("Usage: %s [--breakdown] [--replay MODEL] [--replay-threads N]\n"
+                   "       [--replay-barrier N] [--jitter [--jitter-cpu N]\n"
+                   "       [--jitter-threshold NS] [--jitter-duration S]]\n"
+                   "       [--virt [--virt-baseline FILE]] [--ustime]\n"
+                   "       [--json FILE | --csv FILE]\n", argv[0]);
+            printf("  --breakdown         Only measure the per-component cost attribution\n");
+            printf("  --replay MODEL      Inter-call gap model: whisper (default), const:NS,\n"
+                   "                      exp:MEAN, lognormal:MEDIAN:SIGMA, file:PATH,\n"
+                   "                      trace:PATH (perf script output)\n");
+            printf("  --replay-threads N  Replay threads (default: min(nproc, 4))\n");
+            printf("  --replay-barrier N  Calls per thread between barriers (default: 8)\n");
+            printf("  --jitter            Only record the gap timeline on one pinned hart\n");
+            printf("  --jitter-cpu N      Hart to pin to (default: first isolated, else current)\n");
+            printf("  --jitter-threshold NS  Record gaps above NS (default: 10000)\n");
+            printf("  --jitter-duration S Spin time in seconds (default: 10)\n");
+            printf("  --virt              Only detect the hypervisor and measure guest time costs\n");
+            printf("  --virt-baseline FILE  --json output of a --virt run on the host to compare\n");
+            printf("  --ustime            Measure the user-space timestamp source instead of the vDSO\n");
+            return strcmp(argv[i], "--help") == 0 ? 0 : 2;
+        }
+    }
 
     printf("==============================================\n");
     printf("RISC-V VDSO Time Caching Performance Benchmark\n");
     printf("==============================================\n");
+    vdso_gettime = vdso_timing_vdso_gettime();
 
-    /* Check CPU frequency */
-    FILE *fp = fopen("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq", "r");
-    if (fp) {
-        unsigned long freq_khz;
-        if (fscanf(fp, "%lu", &freq_khz) == 1) {
-            printf("CPU Frequency: %.2f MHz\n", freq_khz / 1000.0);
-        }
-        fclose(fp);
+    /* Before calibration: guests may not let user space read rdcycle */
+    if (virt) {
+        test_virt(virt_baseline);
+        vdso_results_close();
+        return 0;
+    }
+
+    /* Calibrate the counter against CLOCK_MONOTONIC_RAW and the timebase */
+    if (vdso_timing_init() < 0) {
+        fprintf(stderr, "cycle counter calibration failed\n");
+        vdso_results_close();
+        return 1;
+    }
+    printf("Calibration:\n");
+    vdso_timing_print("  ");
+    if (use_ustime) {
+        if (vdso_ustime_init(vdso_timing_read, NULL, 0) < 0)
+            printf("User-space timestamp source unavailable, calls pass through\n");
+        else
+            printf("Measuring the user-space timestamp source (vdso_ustime.h)\n");
+    }
+
+    /* Trap cost vs generic vDSO overhead, the baseline for everything below */
+    if (vdso_breakdown_measure(&bd, clock_gettime_vdso) < 0) {
+        perror("vdso_breakdown_measure");
+        return 1;
+    }
+    printf("\n=== Cost Attribution (median per call) ===\n");
+    vdso_results_scope("breakdown", VDSO_BD_SAMPLES * VDSO_BD_BATCH);
+    vdso_breakdown_print(&bd, "  ");
+    vdso_breakdown_emit(&bd);
+    if (breakdown_only) {
+        vdso_results_close();
+        return 0;
+    }
+
+    /* Cycles, instructions and M-mode traps per call, where exposed */
+    if (!vdso_perf_open(&perf))
+        printf("\nperf counters unavailable, trap counts not reported\n");
+
+    if (jitter) {
+        test_jitter(jitter_cpu >= 0 ? jitter_cpu : sched_getcpu(),
+                    jitter_threshold, jitter_duration);
+        vdso_perf_close(&perf);
+        vdso_results_close();
+        return 0;
     }
 
     /* Run main benchmark */
@@ -230,6 +1052,7 @@ int main(int argc, char **argv)
         .iterations = 10000,  /* Fewer iterations for syscall (slower) */
         .warmup_iterations = 100,
         .name = "Syscall clock_gettime",
+        .clock = CLOCK_MONOTONIC,
     };
     struct benchmark_result syscall_result = run_benchmark(clock_gettime_syscall, &syscall_config);
     print_result(&syscall_result, &vdso_result);
@@ -238,27 +1061,48 @@ int main(int argc, char **argv)
     printf("\n=== VDSO vs Syscall Comparison ===\n");
     printf("VDSO is %.2fx faster than syscall\n",
            syscall_result.avg_cycles / vdso_result.avg_cycles);
+    vdso_results_scope("comparison", 0);
+    vdso_results_emit("vdso vs syscall speedup",
+                      syscall_result.avg_cycles / vdso_result.avg_cycles, "x", -1);
 
     /* Cache analysis */
     printf("\n=== Cache Effectiveness Analysis ===\n");
+    vdso_results_scope("cache_analysis", vdso_result.iterations);
 
-    /* Without cache: CSR_TIME takes ~250 cycles */
-    double no_cache_cycles = 250.0;
+    /*
+     * A miss pays the measured uncached cost, a hit the same minus the
+     * counter read, so the average places us between the two.
+     */
+    double no_cache_cycles = vdso_breakdown_uncached(&bd);
     double actual_cycles = vdso_result.avg_cycles;
 
-    if (actual_cycles < no_cache_cycles) {
-        double cache_hit_rate = (1.0 - (actual_cycles / no_cache_cycles)) * 100.0;
+    if (actual_cycles < no_cache_cycles && bd.counter > 0) {
+        double cache_hit_rate = (no_cache_cycles - actual_cycles) / bd.counter * 100.0;
+
+        if (cache_hit_rate > 100.0)
+            cache_hit_rate = 100.0;
         printf("Estimated cache hit rate: %.1f%%\n", cache_hit_rate);
-        printf("(Avg: %.0f cycles vs ~250 cycles without cache)\n",
-               actual_cycles);
+        vdso_results_emit("estimated cache hit rate", cache_hit_rate, "%", -1);
+        printf("(Avg: %.0f cycles vs %.0f cycles estimated without cache)\n",
+               actual_cycles, no_cache_cycles);
     } else {
         printf("Cache may not be enabled or effective\n");
-        printf("(Avg: %.0f cycles, expected < 250 with cache)\n",
-               actual_cycles);
+        printf("(Avg: %.0f cycles, expected < %.0f with cache)\n",
+               actual_cycles, no_cache_cycles);
     }
+    printf("Median: %.1f ns, p99: %.1f ns, p99.99: %.1f ns\n",
+           vdso_cycles_to_ns((double)vdso_hist_percentile(vdso_result.hist, 50.0)),
+           vdso_cycles_to_ns((double)vdso_hist_percentile(vdso_result.hist, 99.0)),
+           vdso_cycles_to_ns((double)vdso_hist_percentile(vdso_result.hist, 99.99)));
 
     /* Run additional tests */
+    test_clock_ids(100000);
+    test_time_path();
     simulate_ai_inference(100);
+    test_multi_clock(&bd, 100000);
+    test_hybrid_clock(&bd, 100000);
+    test_thread_hit_rate(&bd, nproc);
+    test_replay(&bd, replay_spec, replay_threads, replay_barrier);
     test_cache_hit_rate(5);
 
     printf("\n==============================================\n");
@@ -269,7 +1113,13 @@ int main(int argc, char **argv)
     printf("  - If avg cycles < 100: Cache working well (>60%% hits)\n");
     printf("  - If avg cycles ~200-300: Cache not effective or disabled\n");
     printf("  - If avg cycles > 500: Possible issue (check dmesg)\n");
+    printf("  - A second peak in the distribution is the CSR_TIME trap path\n");
     printf("\nTo enable cache: CONFIG_RISCV_VDSO_TIME_CACHE=y\n");
 
+    vdso_perf_close(&perf);
+    vdso_hist_free(syscall_result.hist);
+    vdso_hist_free(vdso_result.hist);
+    vdso_results_close();
+
     return 0;
 }
@@ -11,8 +11,16 @@
 #   --full         Full test suite
 #   --performance  Performance tests only
 #   --accuracy     Accuracy tests only
+#   --scaling      Multi-hart scaling tests only
 #   --report       Generate HTML report
-#   --json         Generate JSON report
+#   --json         Generate JSON report (per-metric JSON lines from the
+#                  test binaries, summarised into one report file)
+#   --runs N       Repeat the selected tests N times (with --json every
+#                  metric gets N samples for --compare)
+#   --compare BASE NEW
+#                  Compare two stored .jsonl result sets (e.g. cache=y vs
+#                  cache=n) instead of running tests
+#   --threshold P  Regression threshold for --compare in percent (default 5)
 #   --clean        Clean test binaries
 #   --help         Show this help
 
@@ -31,10 +39,15 @@ BUILD_DIR="$TEST_DIR/build"
 REPORT_DIR="$TEST_DIR/reports"
 TEST_PROGRAM="$BUILD_DIR/vdso_cache_test"
 PERF_PROGRAM="$BUILD_DIR/vdso_perf_benchmark"
+COMPARE_PROGRAM="$BUILD_DIR/vdso_compare"
 
 # Test results
 TESTS_PASS=0
 TESTS_FAIL=0
+RESULTS_FILE=""
+COMPARE_BASE=""
+COMPARE_NEW=""
+COMPARE_THRESHOLD=5
 TEST_START_TIME=$(date +%s)
 
 # Functions
@@ -62,6 +75,15 @@ print_header() {
     echo ""
 }
 
+# Run a test binary, appending its metrics to RESULTS_FILE when one is set
+run_with_results() {
+    if [ -n "$RESULTS_FILE" ]; then
+        "$@" --json "$RESULTS_FILE"
+    else
+        "$@"
+    fi
+}
+
 check_root() {
     if [ "$EUID" -ne 0 ]; then
         log_warning "Not running as root. Some tests may fail."
@@ -122,7 +144,8 @@ build_tests() {
     cd "$TEST_DIR"
 
     # Check if rebuild is needed
-    if [ -f "$TEST_PROGRAM" ] && [ "$TEST_PROGRAM" -nt "vdso_cache_test.c" ]; then
+    if [ -f "$TEST_PROGRAM" ] && [ "$TEST_PROGRAM" -nt "vdso_cache_test.c" ] &&
+       [ "$COMPARE_PROGRAM" -nt "vdso_compare.c" ]; then
         log_info "Test binaries already up to date"
         return 0
     fi
@@ -130,7 +153,7 @@ build_tests() {
     log_info "Compiling test programs..."
 
     # Build main test program
-    gcc -O2 -g -o "$TEST_PROGRAM" vdso_cache_test.c -lrt -lpthread
+    gcc -O2 -g -o "$TEST_PROGRAM" vdso_cache_test.c -lrt -lpthread -lm -ldl
     if [ $? -eq 0 ]; then
         log_success "Built: vdso_cache_test"
     else
@@ -140,12 +163,21 @@ build_tests() {
 
     # Build performance benchmark
     if [ -f "vdso_perf_benchmark.c" ]; then
-        gcc -O2 -g -o "$PERF_PROGRAM" vdso_perf_benchmark.c -lrt
+        gcc -O2 -g -o "$PERF_PROGRAM" vdso_perf_benchmark.c -lrt -lm
         if [ $? -eq 0 ]; then
             log_success "Built: vdso_perf_benchmark"
         fi
     fi
 
+    # Build the A/B comparison tool
+    gcc -O2 -g -o "$COMPARE_PROGRAM" vdso_compare.c -lm
+    if [ $? -eq 0 ]; then
+        log_success "Built: vdso_compare"
+    else
+        log_error "Failed to build vdso_compare"
+        return 1
+    fi
+
     return 0
 }
 
@@ -158,7 +190,7 @@ run_quick_tests() {
         build_tests || return 1
     fi
 
-    "$TEST_PROGRAM" --quick
+    run_with_results "$TEST_PROGRAM" --quick
     return $?
 }
 
@@ -171,7 +203,7 @@ run_full_tests() {
         build_tests || return 1
     fi
 
-    "$TEST_PROGRAM"
+    run_with_results "$TEST_PROGRAM"
     return $?
 }
 
@@ -184,7 +216,7 @@ run_performance_tests() {
         build_tests || return 1
     fi
 
-    "$PERF_PROGRAM"
+    run_with_results "$PERF_PROGRAM"
     return $?
 }
 
@@ -197,10 +229,56 @@ run_accuracy_tests() {
         build_tests || return 1
     fi
 
-    "$TEST_PROGRAM" --skip-perf --skip-stress
+    run_with_results "$TEST_PROGRAM" --skip-perf --skip-stress --skip-robust
     return $?
 }
 
+run_scaling_tests() {
+    print_header "Running Scaling Tests"
+    check_root || true
+
+    if [ ! -f "$TEST_PROGRAM" ]; then
+        log_error "Test program not found. Building..."
+        build_tests || return 1
+    fi
+
+    run_with_results "$TEST_PROGRAM" --scaling
+    return $?
+}
+
+run_comparison() {
+    print_header "A/B Comparison"
+
+    if [ ! -x "$COMPARE_PROGRAM" ]; then
+        log_error "Comparison tool not found. Building..."
+        build_tests || return 2
+    fi
+
+    local f
+    for f in "$COMPARE_BASE" "$COMPARE_NEW"; do
+        if [ ! -s "$f" ]; then
+            log_error "Result set not found or empty: $f"
+            return 2
+        fi
+    done
+
+    "$COMPARE_PROGRAM" --threshold "$COMPARE_THRESHOLD" "$COMPARE_BASE" "$COMPARE_NEW"
+}
+
+# Comparison table for the HTML report, or how to produce one
+html_comparison() {
+    if [ -n "$COMPARE_BASE" ]; then
+        "$COMPARE_PROGRAM" --html --threshold "$COMPARE_THRESHOLD" \
+            "$COMPARE_BASE" "$COMPARE_NEW" || true
+    else
+        cat <<HTML
+        <p>No comparison in this report. Record each configuration with
+        <code>$0 --json --runs 5</code>, then run
+        <code>$0 --compare BASE.jsonl NEW.jsonl --report</code>.</p>
+HTML
+    fi
+}
+
 generate_html_report() {
     print_header "Generating HTML Report"
 
@@ -221,6 +299,11 @@ generate_html_report() {
         .fail { color: #e74c3c; font-weight: bold; }
         .metric { display: inline-block; margin: 10px; padding: 10px; background: #ecf0f1; border-radius: 3px; }
         .timestamp { color: #7f8c8d; font-size: 0.9em; }
+        table { border-collapse: collapse; font-size: 0.9em; }
+        th, td { padding: 4px 8px; border-bottom: 1px solid #ecf0f1; text-align: right; }
+        td:first-child, th:first-child { text-align: left; }
+        tr.fail td { color: #e74c3c; font-weight: bold; }
+        tr.pass td { color: #27ae60; }
     </style>
 </head>
 <body>
@@ -255,17 +338,13 @@ $(check_kernel_config 2>&1 | sed 's/\x1b\[[0-9;]*m//g')
     <div class="section">
         <h2>Performance Results</h2>
         <pre>
-$(run_performance_tests 2>&1 | sed 's/\x1b\[[0-9;]*m//g')
+$([ -z "$COMPARE_BASE" ] && run_performance_tests 2>&1 | sed 's/\x1b\[[0-9;]*m//g')
         </pre>
     </div>
 
     <div class="section">
-        <h2>Recommendations</h2>
-        <ul>
-            <li>Compare results with and without CONFIG_RISCV_VDSO_TIME_CACHE</li>
-            <li>Run tests multiple times to get consistent measurements</li>
-            <li>Check dmesg for any VDSO-related errors</li>
-        </ul>
+        <h2>A/B Comparison</h2>
+$(html_comparison)
     </div>
 </body>
 </html>
@@ -280,6 +359,12 @@ generate_json_report() {
     mkdir -p "$REPORT_DIR"
     local report_file="$REPORT_DIR/test_results_$(date +%Y%m%d_%H%M%S).json"
 
+    # Pass/fail records are emitted with unit "pass" by the test binaries
+    if [ -s "$RESULTS_FILE" ]; then
+        TESTS_PASS=$(grep -c '"value":1,"unit":"pass"' "$RESULTS_FILE" || true)
+        TESTS_FAIL=$(grep -c '"value":0,"unit":"pass"' "$RESULTS_FILE" || true)
+    fi
+
     cat > "$report_file" <<EOF
 {
     "test_suite": "RISC-V VDSO Time Cache",
@@ -292,8 +377,11 @@ generate_json_report() {
         "failed": $TESTS_FAIL
     },
     "environment": {
-        "cpu_freq_mhz": $(cat /sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq 2>/dev/null | awk '{print $1/1000}' || echo "null")
-    }
+        "cpu_freq_mhz": $(awk '{print $1/1000; found=1} END {if (!found) print "null"}' /sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq 2>/dev/null || echo "null")
+    },
+    "metrics": [
+$( [ -s "$RESULTS_FILE" ] && sed 's/^/        /; $!s/$/,/' "$RESULTS_FILE" )
+    ]
 }
 EOF
 
@@ -318,8 +406,13 @@ Options:
   --full         Run full test suite (default)
   --performance  Run performance tests only
   --accuracy     Run accuracy tests only
+  --scaling      Run multi-hart scaling tests only
   --report       Generate HTML report
   --json         Generate JSON report
+  --runs N       Repeat the selected tests N times
+  --compare BASE NEW
+                 Compare two stored .jsonl result sets (no tests are run)
+  --threshold P  Regression threshold for --compare, percent (default 5)
   --clean        Clean test binaries and reports
   --help         Show this help message
 
@@ -328,11 +421,14 @@ Examples:
   $0 --quick              # Run quick tests
   $0 --performance        # Run only performance tests
   $0 --report             # Generate HTML report after tests
+  $0 --json --runs 5      # Record a result set with 5 samples per metric
+  $0 --compare reports/cache_n.jsonl reports/cache_y.jsonl --report
 
 Notes:
   - Some tests require root privileges for accurate results
   - For best results, run on an idle system
-  - Compare results with CONFIG_RISCV_VDSO_TIME_CACHE enabled/disabled
+  - --compare exits with 1 if any metric regressed beyond the threshold
+    with significance (bootstrap 95% CI and Mann-Whitney p < 0.05)
 HELP
 }
 
@@ -341,6 +437,7 @@ main() {
     local mode="full"
     local gen_report=false
     local gen_json=false
+    local runs=1
 
     # Parse arguments
     while [ $# -gt 0 ]; do
@@ -361,6 +458,10 @@ main() {
                 mode="accuracy"
                 shift
                 ;;
+            --scaling)
+                mode="scaling"
+                shift
+                ;;
             --report)
                 gen_report=true
                 shift
@@ -369,6 +470,20 @@ main() {
                 gen_json=true
                 shift
                 ;;
+            --runs)
+                runs="$2"
+                shift 2
+                ;;
+            --compare)
+                mode="compare"
+                COMPARE_BASE="$2"
+                COMPARE_NEW="$3"
+                shift 3
+                ;;
+            --threshold)
+                COMPARE_THRESHOLD="$2"
+                shift 2
+                ;;
             --clean)
                 clean
                 exit 0
@@ -385,30 +500,58 @@ main() {
         esac
     done
 
+    if [ "$mode" = "compare" ]; then
+        if [ -z "$COMPARE_BASE" ] || [ -z "$COMPARE_NEW" ]; then
+            echo "--compare needs two result files"
+            exit 1
+        fi
+        # run_comparison only needs vdso_compare and reports if it is missing
+        build_tests || log_warning "Build failed, using the existing binaries"
+        local compare_status=0
+        run_comparison || compare_status=$?
+        if [ "$gen_report" = true ]; then
+            generate_html_report
+        fi
+        exit $compare_status
+    fi
+
     # Run pre-flight checks
     print_header "VDSO Cache Test Suite"
     log_info "Test mode: $mode"
     log_info "Start time: $(date)"
 
-    check_kernel_config
+    check_kernel_config || true
     check_vdso
-    build_tests
+    build_tests || exit 1
+
+    if [ "$gen_json" = true ]; then
+        mkdir -p "$REPORT_DIR"
+        RESULTS_FILE="$REPORT_DIR/test_results_$(date +%Y%m%d_%H%M%S).jsonl"
+        log_info "Per-metric results: $RESULTS_FILE"
+    fi
 
     # Run tests based on mode
-    case "$mode" in
-        quick)
-            run_quick_tests || true
-            ;;
-        performance)
-            run_performance_tests || true
-            ;;
-        accuracy)
-            run_accuracy_tests || true
-            ;;
-        full)
-            run_full_tests || true
-            ;;
-    esac
+    local run
+    for run in $(seq 1 "$runs"); do
+        [ "$runs" -gt 1 ] && log_info "Run $run of $runs"
+        case "$mode" in
+            quick)
+                run_quick_tests || true
+                ;;
+            performance)
+                run_performance_tests || true
+                ;;
+            accuracy)
+                run_accuracy_tests || true
+                ;;
+            scaling)
+                run_scaling_tests || true
+                ;;
+            full)
+                run_full_tests || true
+                ;;
+        esac
+    done
 
     # Capture exit code
     local exit_code=$?
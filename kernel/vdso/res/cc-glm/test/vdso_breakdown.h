@@ -0,0 +1,363 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Per-component cost attribution for clock_gettime()
+ *
+ * Times the raw hardware counter read (rdtime and csr_read(CSR_TIME) on
+ * RISC-V, where it traps to M-mode), the timing counter itself
+ * (VDSO_TIMING_COUNTER) and a null call from user space, together with
+ * user-space replicas of the generic vDSO arithmetic (seqcount read
+ * loop, mult/shift, timespec conversion). These are then subtracted from
+ * the measured clock_gettime() cost.
+ *
+ * A CLOCK_MONOTONIC_COARSE call, which reads no counter, gives the clock
+ * dispatch overhead the replicas miss. What the measured call costs beyond
+ * all of that tells how many counter reads per call the time cache left,
+ * and the uncached cost follows from the measured call by adding the
+ * avoided reads back. This replaces the hardcoded "~250 cycles without
+ * cache" baseline.
+ *
+ * Needs vdso_calib_init() to have selected the cycle reader.
+ */
+
+#ifndef VDSO_BREAKDOWN_H
+#define VDSO_BREAKDOWN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "vdso_hist.h"
+#include "vdso_calib.h"
+#include "vdso_results.h"
+#include "vdso_timing.h"
+
+#define VDSO_BD_BATCH       32      /* ops per timed bracket */
+#define VDSO_BD_SAMPLES     2000    /* brackets per component, median kept */
+#define VDSO_BD_NSEC_PER_SEC 1000000000ULL
+
+struct vdso_breakdown {
+    bool has_counter;       /* a user-readable hardware counter exists */
+    bool has_csr_time;      /* RISC-V: csr_read(CSR_TIME) measured too */
+    double timing;          /* back-to-back VDSO_TIMING_COUNTER read */
+    double null_call;       /* indirect call to an empty gettime */
+    double counter;         /* rdtime / rdtsc / cntvct read */
+    double csr_time;        /* csr_read(CSR_TIME), RISC-V only */
+    double seqlock;         /* seqcount begin/retry around the data reads */
+    double mult_shift;      /* (cycles - last) * mult >> shift */
+    double ts_conv;         /* ns -> timespec (__iter_div_u64_rem) */
+    double dispatch;        /* clock id dispatch, vdso data lookup */
+    double vdso;            /* measured clock_gettime() */
+};
+
+/* Mirror of the vdso_clock fields the generic code reads */
+struct vdso_bd_clock {
+    uint32_t seq;
+    int32_t clock_mode;
+    uint64_t cycle_last;
+    uint64_t mask;
+    uint32_t mult;
+    uint32_t shift;
+    uint64_t sec;
+    uint64_t nsec;
+};
+
+static volatile uint64_t vdso_bd_sink;
+
+static inline uint64_t vdso_bd_read_counter(void)
+{
+    uint64_t v = 0;
+#if defined(__riscv)
+    asm volatile("rdtime %0" : "=r"(v));
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned int hi, lo;
+
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    v = ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+#endif
+    return v;
+}
+
+static inline uint64_t vdso_bd_read_csr_time(void)
+{
+    uint64_t v = 0;
+#if defined(__riscv)
+    /* Same as the kernel's csr_read(CSR_TIME) */
+    asm volatile("csrr %0, time" : "=r"(v) : : "memory");
+#endif
+    return v;
+}
+
+static __attribute__((noinline)) int vdso_bd_null_gettime(clockid_t clk,
+                                                          struct timespec *ts)
+{
+    (void)clk;
+    asm volatile("" : : "r"(ts) : "memory");
+    return 0;
+}
+
+/* Kernel's __iter_div_u64_rem(): the quotient is almost always 0 or 1 */
+static inline uint32_t vdso_bd_iter_div(uint64_t dividend, uint32_t divisor,
+                                        uint64_t *remainder)
+{
+    uint32_t ret = 0;
+
+    while (dividend >= divisor) {
+        asm("" : "+rm"(dividend));
+        dividend -= divisor;
+        ret++;
+    }
+    *remainder = dividend;
+    return ret;
+}
+
+enum vdso_bd_op {
+    VDSO_BD_EMPTY,
+    VDSO_BD_TIMING,
+    VDSO_BD_NULL_CALL,
+    VDSO_BD_COUNTER,
+    VDSO_BD_CSR_TIME,
+    VDSO_BD_SEQLOCK,
+    VDSO_BD_MULT_SHIFT,
+    VDSO_BD_TS_CONV,
+    VDSO_BD_VDSO_COARSE,
+    VDSO_BD_VDSO,
+};
+
+/*
+ * Median cycles for VDSO_BD_BATCH back-to-back @op, per op. The switch is
+ * outside the timed loop so each case compiles to a tight loop.
+ */
+static inline double vdso_bd_time(enum vdso_bd_op op,
+                                  int (*gettime)(clockid_t, struct timespec *),
+                                  struct vdso_hist *h)
+{
+    int (*volatile null_fn)(clockid_t, struct timespec *) = vdso_bd_null_gettime;
+    int (*volatile fn)(clockid_t, struct timespec *) = gettime;
+    volatile struct vdso_bd_clock vc = {
+        .mult = 4194304, .shift = 22, .mask = UINT64_MAX,
+        .cycle_last = 1000, .sec = 1700000000, .nsec = 123456789ULL << 22,
+    };
+    uint64_t (*rd)(void) = vdso_calib.read_cycles;
+    struct timespec ts;
+    uint64_t acc = 0, start, end, rem;
+    int s, i;
+
+    vdso_hist_reset(h);
+    for (s = 0; s < VDSO_BD_SAMPLES; s++) {
+        start = rd();
+        switch (op) {
+        case VDSO_BD_EMPTY:
+            break;
+        case VDSO_BD_TIMING:
+            for (i = 0; i < VDSO_BD_BATCH; i++)
+                acc += rd();
+            break;
+        case VDSO_BD_NULL_CALL:
+            for (i = 0; i < VDSO_BD_BATCH; i++)
+                acc += null_fn(CLOCK_MONOTONIC, &ts);
+            break;
+        case VDSO_BD_COUNTER:
+            for (i = 0; i < VDSO_BD_BATCH; i++)
+                acc += vdso_bd_read_counter();
+            break;
+        case VDSO_BD_CSR_TIME:
+            for (i = 0; i < VDSO_BD_BATCH; i++)
+                acc += vdso_bd_read_csr_time();
+            break;
+        case VDSO_BD_SEQLOCK:
+            for (i = 0; i < VDSO_BD_BATCH; i++) {
+                uint32_t seq;
+
+                do {
+                    seq = vc.seq;
+                    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                    acc += vc.cycle_last + vc.nsec + vc.sec + vc.clock_mode;
+                    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                } while ((seq & 1) || seq != vc.seq);
+            }
+            break;
+        case VDSO_BD_MULT_SHIFT:
+            for (i = 0; i < VDSO_BD_BATCH; i++) {
+                uint64_t cycles = vc.cycle_last + i;
+
+                acc += (((cycles - vc.cycle_last) & vc.mask) * vc.mult +
+                        vc.nsec) >> vc.shift;
+            }
+            break;
+        case VDSO_BD_TS_CONV:
+            for (i = 0; i < VDSO_BD_BATCH; i++) {
+                uint64_t ns = vc.nsec >> vc.shift;
+
+                ts.tv_sec = vc.sec + vdso_bd_iter_div(ns, VDSO_BD_NSEC_PER_SEC, &rem);
+                ts.tv_nsec = rem;
+                acc += ts.tv_sec + ts.tv_nsec;
+            }
+            break;
+        case VDSO_BD_VDSO_COARSE:
+            for (i = 0; i < VDSO_BD_BATCH; i++)
+                acc += fn(CLOCK_MONOTONIC_COARSE, &ts);
+            break;
+        case VDSO_BD_VDSO:
+            for (i = 0; i < VDSO_BD_BATCH; i++)
+                acc += fn(CLOCK_MONOTONIC, &ts);
+            break;
+        }
+        end = rd();
+        vdso_hist_record(h, end - start);
+    }
+    vdso_bd_sink = acc;
+
+    return (double)vdso_hist_percentile(h, 50.0) / VDSO_BD_BATCH;
+}
+
+static inline double vdso_bd_net(double v)
+{
+    return v > 0 ? v : 0;
+}
+
+/* Measure every component; @gettime is the clock_gettime() under test */
+static inline int vdso_breakdown_measure(struct vdso_breakdown *b,
+                                         int (*gettime)(clockid_t, struct timespec *))
+{
+    struct vdso_hist *h = vdso_hist_alloc();
+    double empty, coarse;
+
+    if (!h)
+        return -1;
+
+    memset(b, 0, sizeof(*b));
+#if defined(__riscv) || defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    b->has_counter = true;
+#endif
+#if defined(__riscv)
+    b->has_csr_time = true;
+#endif
+
+    /* Fixed bracket cost, spread over a batch, is removed from every op */
+    empty = vdso_bd_time(VDSO_BD_EMPTY, gettime, h);
+
+    b->timing = vdso_bd_net(vdso_bd_time(VDSO_BD_TIMING, gettime, h) - empty);
+    b->null_call = vdso_bd_net(vdso_bd_time(VDSO_BD_NULL_CALL, gettime, h) - empty);
+    if (b->has_counter)
+        b->counter = vdso_bd_net(vdso_bd_time(VDSO_BD_COUNTER, gettime, h) - empty);
+    if (b->has_csr_time)
+        b->csr_time = vdso_bd_net(vdso_bd_time(VDSO_BD_CSR_TIME, gettime, h) - empty);
+    b->seqlock = vdso_bd_net(vdso_bd_time(VDSO_BD_SEQLOCK, gettime, h) - empty);
+    b->mult_shift = vdso_bd_net(vdso_bd_time(VDSO_BD_MULT_SHIFT, gettime, h) - empty);
+    b->ts_conv = vdso_bd_net(vdso_bd_time(VDSO_BD_TS_CONV, gettime, h) - empty);
+    b->vdso = vdso_bd_net(vdso_bd_time(VDSO_BD_VDSO, gettime, h) - empty);
+
+    /* A coarse read is call + seqlock loop + dispatch, without a counter */
+    coarse = vdso_bd_net(vdso_bd_time(VDSO_BD_VDSO_COARSE, gettime, h) - empty);
+    b->dispatch = vdso_bd_net(coarse - b->null_call - b->seqlock);
+
+    vdso_hist_free(h);
+    return 0;
+}
+
+/* Everything in a vDSO call except the counter read */
+static inline double vdso_breakdown_software(const struct vdso_breakdown *b)
+{
+    return b->null_call + b->seqlock + b->mult_shift + b->ts_conv + b->dispatch;
+}
+
+/*
+ * Counter reads implied by @cycles spent on work whose non-trap part costs
+ * @software, clamped to [0, @max]. Used for single calls and for batches.
+ */
+static inline double vdso_breakdown_reads(const struct vdso_breakdown *b,
+                                          double cycles, double software,
+                                          double max)
+{
+    double r;
+
+    if (b->counter <= 0)
+        return 0;
+    r = (cycles - software) / b->counter;
+    return r < 0 ? 0 : (r > max ? max : r);
+}
+
+/*
+ * Counter reads per call implied by the measured cost: ~1 without the
+ * time cache, ~0 when nearly every call is a cache hit.
+ */
+static inline double vdso_breakdown_reads_per_call(const struct vdso_breakdown *b)
+{
+    return vdso_breakdown_reads(b, b->vdso, vdso_breakdown_software(b), 1);
+}
+
+/*
+ * Expected cost of a vDSO call that reads the counter every time: the
+ * measured call plus the reads the cache avoided. Anchoring on the
+ * measured call keeps whatever the components miss in the estimate.
+ */
+static inline double vdso_breakdown_uncached(const struct vdso_breakdown *b)
+{
+    return b->vdso + (1 - vdso_breakdown_reads_per_call(b)) * b->counter;
+}
+
+static inline void vdso_breakdown_print_row(const char *indent, const char *name,
+                                            double cycles, double total)
+{
+    printf("%s%-34s %9.2f %9.2f", indent, name, cycles, vdso_cycles_to_ns(cycles));
+    if (total > 0)
+        printf(" %6.1f%%", cycles / total * 100.0);
+    printf("\n");
+}
+
+static inline void vdso_breakdown_print(const struct vdso_breakdown *b,
+                                        const char *indent)
+{
+    double reads = vdso_breakdown_reads_per_call(b);
+    double trap = reads * b->counter;
+    double other = b->vdso - vdso_breakdown_software(b) - trap;
+
+    printf("%s%-34s %9s %9s %7s\n", indent, "Reference", "cycles", "ns", "");
+    vdso_breakdown_print_row(indent, VDSO_TIMING_COUNTER, b->timing, 0);
+    vdso_breakdown_print_row(indent, "null call", b->null_call, 0);
+#if defined(__riscv)
+    vdso_breakdown_print_row(indent, "rdtime (CSR_TIME trap)", b->counter, 0);
+    vdso_breakdown_print_row(indent, "csr_read(CSR_TIME)", b->csr_time, 0);
+#else
+    vdso_breakdown_print_row(indent, "hardware counter read", b->counter, 0);
+#endif
+    vdso_breakdown_print_row(indent, "uncached vDSO call (estimated)",
+                             vdso_breakdown_uncached(b), 0);
+
+    printf("%s%-34s %9s %9s %7s\n", indent, "clock_gettime() breakdown",
+           "cycles", "ns", "share");
+    vdso_breakdown_print_row(indent, "call + return", b->null_call, b->vdso);
+    vdso_breakdown_print_row(indent, "counter read / trap", trap, b->vdso);
+    vdso_breakdown_print_row(indent, "seqlock loop", b->seqlock, b->vdso);
+    vdso_breakdown_print_row(indent, "mult/shift", b->mult_shift, b->vdso);
+    vdso_breakdown_print_row(indent, "timespec conversion", b->ts_conv, b->vdso);
+    vdso_breakdown_print_row(indent, "clock dispatch", b->dispatch, b->vdso);
+    vdso_breakdown_print_row(indent, "other (cache, unattributed)",
+                             other > 0 ? other : 0, b->vdso);
+    vdso_breakdown_print_row(indent, "total (measured)", b->vdso, b->vdso);
+    printf("%sCounter reads per call: %.2f (1.00 = every call traps)\n",
+           indent, reads);
+}
+
+/* Emit every component under the current vdso_results scope */
+static inline void vdso_breakdown_emit(const struct vdso_breakdown *b)
+{
+    vdso_results_emit(VDSO_TIMING_COUNTER, b->timing, "cycles", -1);
+    vdso_results_emit("null call", b->null_call, "cycles", -1);
+    vdso_results_emit("counter read", b->counter, "cycles", -1);
+    if (b->has_csr_time)
+        vdso_results_emit("csr time", b->csr_time, "cycles", -1);
+    vdso_results_emit("seqlock", b->seqlock, "cycles", -1);
+    vdso_results_emit("mult shift", b->mult_shift, "cycles", -1);
+    vdso_results_emit("ts conv", b->ts_conv, "cycles", -1);
+    vdso_results_emit("dispatch", b->dispatch, "cycles", -1);
+    vdso_results_emit("vdso", b->vdso, "cycles", -1);
+    vdso_results_emit("uncached estimate", vdso_breakdown_uncached(b), "cycles", -1);
+    vdso_results_emit("counter reads per call",
+                      vdso_breakdown_reads_per_call(b), "ratio", -1);
+}
+
+#endif /* VDSO_BREAKDOWN_H */
@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Exact time cache counters from the vDSO
+ *
+ * With CONFIG_RISCV_VDSO_TIME_CACHE_STATS (riscv-vdso-cache-patch-fix/0008)
+ * the vDSO counts hits, misses and invalidations per thread and exports
+ * __vdso_time_cache_stats() to read them. Counters are cumulative for the
+ * calling thread; take a snapshot before and after the code under test and
+ * diff them.
+ *
+ * vdso_cache_stats_read() returns false when the kernel does not export
+ * the symbol, so callers can fall back to latency-based estimates.
+ */
+
+#ifndef VDSO_CACHE_STATS_H
+#define VDSO_CACHE_STATS_H
+
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Layout of struct vdso_time_cache_stats in the kernel patch */
+struct vdso_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+};
+
+typedef int (*vdso_cache_stats_fn)(struct vdso_cache_stats *stats);
+
+static struct {
+    bool probed;
+    vdso_cache_stats_fn fn;
+} vdso_cache_stats;
+
+/* Resolve __vdso_time_cache_stats once; NULL if the vDSO lacks it */
+static inline vdso_cache_stats_fn vdso_cache_stats_lookup(void)
+{
+    void *h;
+
+    if (vdso_cache_stats.probed)
+        return vdso_cache_stats.fn;
+    vdso_cache_stats.probed = true;
+
+    h = dlopen("linux-vdso.so.1", RTLD_NOW | RTLD_NOLOAD);
+    if (!h)
+        return NULL;
+    vdso_cache_stats.fn = (vdso_cache_stats_fn)dlsym(h, "__vdso_time_cache_stats");
+    return vdso_cache_stats.fn;
+}
+
+static inline bool vdso_cache_stats_available(void)
+{
+    return vdso_cache_stats_lookup() != NULL;
+}
+
+/* Snapshot the calling thread's counters */
+static inline bool vdso_cache_stats_read(struct vdso_cache_stats *s)
+{
+    vdso_cache_stats_fn fn = vdso_cache_stats_lookup();
+
+    return fn && fn(s) == 0;
+}
+
+/* @end - @start, field by field */
+static inline void vdso_cache_stats_delta(const struct vdso_cache_stats *start,
+                                          const struct vdso_cache_stats *end,
+                                          struct vdso_cache_stats *d)
+{
+    d->hits = end->hits - start->hits;
+    d->misses = end->misses - start->misses;
+    d->invalidations = end->invalidations - start->invalidations;
+}
+
+/* Hit rate in percent; 0 if there were no calls */
+static inline double vdso_cache_stats_hit_rate(const struct vdso_cache_stats *d)
+{
+    uint64_t calls = d->hits + d->misses;
+
+    return calls ? (double)d->hits / calls * 100.0 : 0.0;
+}
+
+#endif /* VDSO_CACHE_STATS_H */
@@ -24,12 +24,28 @@
 #include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/time.h>
 #include <pthread.h>
 #include <sched.h>
 #include <signal.h>
 #include <setjmp.h>
 #include <errno.h>
+#include <sys/timex.h>
+#include <linux/futex.h>
 #include <linux/time_types.h>
+#include <dlfcn.h>
+
+#include "vdso_hist.h"
+#include "vdso_results.h"
+#include "vdso_calib.h"
+#include "vdso_timing.h"
+#include "vdso_breakdown.h"
+#include "vdso_hybrid.h"
+#include "vdso_cache_stats.h"
+#include "vdso_perf.h"
+#include "vdso_clocks.h"
+#include "vdso_ustime.h"
 
 /* Test configuration */
 #define TEST_ITERATIONS       1000000
@@ -37,6 +53,26 @@
 #define MONOTONIC_CHECKS      10000
 #define ACCURACY_SAMPLES      1000
 #define STRESS_DURATION_SEC   10
+#define SCALING_ITERATIONS    200000
+#define STALENESS_SAMPLES     1000
+#define STRICT_SAMPLES        10000
+#define HYBRID_SAMPLES        10000
+#define HYBRID_ERROR_NS       10000   /* 10us target of the hybrid clock */
+#define STORM_DURATION_NS     2000000000LL
+#define STORM_PERIOD_NS       2000000     /* one timekeeping update per period */
+#define STORM_JUMP_NS         10000000    /* clock_settime step, alternating +/- */
+#define STORM_SLEW_PPM        100         /* adjtimex frequency toggle */
+#define STORM_TOLERANCE_NS    1000000     /* offset error that counts as stale */
+#define STORM_BIN_NS          10000       /* burst histogram resolution */
+#define STORM_BINS            100         /* bins after a bump; later = steady */
+#define STORM_MAX_THREADS     16
+#define ROBUST_FORKS          100
+#define ROBUST_EXECS          10
+#define ROBUST_READS          1000    /* bracketed reads per child/thread */
+#define ROBUST_SIGNAL_HZ      10000
+#define ROBUST_SIGNAL_SEC     1
+#define ROBUST_TLS_AREA       65536   /* custom TLS block, tp in the middle */
+#define ROBUST_STACK_SIZE     (256 * 1024)
 
 /* Test result tracking */
 static int tests_passed = 0;
@@ -50,30 +86,19 @@ static int tests_skipped = 0;
 #define COLOR_BLUE   "\033[0;34m"
 #define COLOR_RESET  "\033[0m"
 
-/* Cycle counter access - multi-architecture support */
-static inline uint64_t rdcycle(void)
-{
-    uint64_t cycles;
-#if defined(__riscv)
-    asm volatile("rdcycle %0" : "=r"(cycles));
-#elif defined(__x86_64__) || defined(__i386__)
-    unsigned int hi, lo;
-    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
-    cycles = ((uint64_t)hi << 32) | lo;
-#else
-    /* Fallback: use clock_gettime */
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    cycles = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
-#endif
-    return cycles;
-}
+/* --ustime: run every test against the user-space source in vdso_ustime.h */
+static bool use_ustime;
+
+/* --storm: S004 steps CLOCK_REALTIME and rewrites the NTP frequency */
+static bool run_storm;
 
 /* Direct VDSO call */
 /* Note: On modern systems, clock_gettime() already uses VDSO when available.
  * This wrapper ensures we're testing the fast path. */
 static inline int clock_gettime_vdso(clockid_t clk, struct timespec *ts)
 {
+    if (use_ustime)
+        return vdso_ustime_gettime(clk, ts);
     return clock_gettime(clk, ts);
 }
 
@@ -108,6 +133,7 @@ static void print_header(const char *title)
 
 static void print_test(const char *name, bool passed)
 {
+    vdso_results_emit(name, passed, "pass", -1);
     if (passed) {
         printf("  " COLOR_GREEN "✓" COLOR_RESET " %s\n", name);
         tests_passed++;
@@ -117,36 +143,97 @@ static void print_test(const char *name, bool passed)
     }
 }
 
+/* Cycle counts are followed by ns, which compare across architectures */
 static void print_value(const char *name, double value, const char *unit)
 {
-    printf("  • %s: %.2f %s\n", name, value, unit);
+    double ns = strcmp(unit, "cycles") == 0 ? vdso_cycles_to_ns(value) : 0.0;
+
+    if (ns > 0)
+        printf("  • %s: %.2f %s (%.1f ns)\n", name, value, unit, ns);
+    else
+        printf("  • %s: %.2f %s\n", name, value, unit);
+    vdso_results_emit(name, value, unit, -1);
+}
+
+static void print_hist(const char *indent, const struct vdso_hist *h,
+                       const char *unit)
+{
+    char sub[32];
+
+    printf("  • %sLatency percentiles (%lu samples):\n", indent,
+           (unsigned long)h->count);
+    snprintf(sub, sizeof(sub), "      %s", indent);
+    vdso_hist_print_percentiles(h, sub, unit, vdso_cycles_to_ns(1.0));
+    printf("  • %sLatency distribution (%s):\n", indent, unit);
+    vdso_hist_print_buckets(h, sub);
+
+    for (unsigned int i = 0; i < VDSO_HIST_NR_PERCENTILES; i++) {
+        char name[32];
+
+        snprintf(name, sizeof(name), "latency p%g", vdso_hist_percentiles[i]);
+        vdso_results_emit(name, vdso_hist_percentile(h, vdso_hist_percentiles[i]),
+                          unit, -1);
+    }
+}
+
+static int64_t ts_diff_ns(const struct timespec *a, const struct timespec *b)
+{
+    return (a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
 }
 
-static double get_cpu_freq_mhz(void)
+/*
+ * Time cache staleness bound: vdso_time_cache_window= on the kernel
+ * command line, else CONFIG_RISCV_VDSO_TIME_CACHE_WINDOW_NS. -1 if the
+ * kernel config has no window, e.g. without the time cache or with the
+ * shared cache scope.
+ */
+static long staleness_bound_ns(void)
 {
-    FILE *fp = fopen("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq", "r");
+    char buf[4096], *p;
+    FILE *fp;
+    long bound;
+
+    if (!vdso_kconfig_get("CONFIG_RISCV_VDSO_TIME_CACHE_WINDOW_NS", buf, sizeof(buf)))
+        return -1;
+    bound = strtol(buf, NULL, 0);
+
+    fp = fopen("/proc/cmdline", "r");
     if (fp) {
-        unsigned long freq_khz;
-        if (fscanf(fp, "%lu", &freq_khz) == 1) {
-            fclose(fp);
-            return freq_khz / 1000.0;
-        }
+        if (fgets(buf, sizeof(buf), fp) &&
+            (p = strstr(buf, "vdso_time_cache_window=")) != NULL)
+            bound = strtol(p + strlen("vdso_time_cache_window="), NULL, 0);
         fclose(fp);
     }
-    /* Fallback: try to estimate from cycle counter */
-    struct timespec ts1, ts2;
-    uint64_t c1, c2;
 
-    clock_gettime(CLOCK_MONOTONIC, &ts1);
-    c1 = rdcycle();
-    usleep(10000); /* 10ms */
-    clock_gettime(CLOCK_MONOTONIC, &ts2);
-    c2 = rdcycle();
+    return bound;
+}
 
-    double sec = (ts2.tv_sec - ts1.tv_sec) + (ts2.tv_nsec - ts1.tv_nsec) / 1e9;
-    double cycles = c2 - c1;
+#if defined(__has_attribute)
+#if __has_attribute(no_stack_protector)
+/* The x86 canary lives at %fs:0x28; clone threads below may have no TLS */
+#define ROBUST_NO_SSP __attribute__((no_stack_protector))
+#endif
+#endif
+#ifndef ROBUST_NO_SSP
+#define ROBUST_NO_SSP
+#endif
 
-    return cycles / sec / 1e6;
+/* Distance of one vDSO read outside the syscall bracket, 0 if inside */
+static ROBUST_NO_SSP int64_t bracket_error_ns(int (*gettime)(clockid_t, struct timespec *),
+                                              clockid_t clk)
+{
+    struct timespec before, ts, after;
+
+    syscall(__NR_clock_gettime, clk, &before);
+    if (gettime(clk, &ts) != 0)
+        return INT64_MAX;
+    syscall(__NR_clock_gettime, clk, &after);
+
+    if (ts_diff_ns(&ts, &before) < 0)
+        return ts_diff_ns(&before, &ts);
+    if (ts_diff_ns(&ts, &after) > 0)
+        return ts_diff_ns(&ts, &after);
+    return 0;
 }
 
 /* ==================== Functional Tests ==================== */
@@ -183,19 +270,45 @@ static bool test_monotonicity(void)
     return true;
 }
 
-static bool test_multiple_clocks(void)
+/*
+ * F003: every vDSO clock ID must land inside [syscall before, syscall
+ * after] on the same clock, give or take the cache staleness bound. The
+ * read is preceded by one of the previous clock in vdso_clock_ids[], so
+ * the cache is always warm from another clock, including from the other
+ * clock_data base (MONOTONIC -> MONOTONIC_RAW -> BOOTTIME).
+ */
+static bool test_clock_ids(void)
 {
-    struct timespec ts_realtime, ts_monotonic, ts_boottime;
+    long bound = staleness_bound_ns();
+    int64_t tolerance = 1000 + (bound > 0 ? bound : 0);
+    bool all_ok = true;
 
-    if (clock_gettime_vdso(CLOCK_REALTIME, &ts_realtime) != 0)
-        return false;
-    if (clock_gettime_vdso(CLOCK_MONOTONIC, &ts_monotonic) != 0)
-        return false;
-    if (clock_gettime_vdso(CLOCK_BOOTTIME, &ts_boottime) != 0)
-        return false;
+    for (unsigned int c = 0; c < VDSO_NR_CLOCK_IDS; c++) {
+        const struct vdso_clock_id *clk = &vdso_clock_ids[c];
+        clockid_t prev = vdso_clock_ids[(c + VDSO_NR_CLOCK_IDS - 1) % VDSO_NR_CLOCK_IDS].id;
+        struct timespec ts;
+        int64_t max_err = 0;
+        bool ok;
+        char name[48];
+
+        for (int i = 0; i < ACCURACY_SAMPLES; i++) {
+            int64_t err;
+
+            clock_gettime_vdso(prev, &ts);
+            err = bracket_error_ns(clock_gettime_vdso, clk->id);
+            if (err > max_err)
+                max_err = err;
+        }
+        ok = max_err <= tolerance;
+        all_ok &= ok;
+
+        snprintf(name, sizeof(name), "  %s outside bracket", clk->name);
+        print_value(name, max_err, "ns");
+        snprintf(name, sizeof(name), "  CLOCK_%s within syscall bracket", clk->name);
+        print_test(name, ok);
+    }
 
-    /* All clocks should return valid times */
-    return ts_realtime.tv_sec > 0 && ts_monotonic.tv_sec >= 0 && ts_boottime.tv_sec >= 0;
+    return all_ok;
 }
 
 static bool test_time_advances(void)
@@ -222,18 +335,23 @@ static void run_functional_tests(void)
     print_header("Functional Tests (F001-F005)");
 
     printf("\nF001: Basic time acquisition\n");
+    vdso_results_scope("F001", 1);
     print_test("  clock_gettime() returns valid time", test_basic_gettime());
 
     printf("\nF002: Monotonicity check (10000 calls)\n");
+    vdso_results_scope("F002", MONOTONIC_CHECKS);
     print_test("  Time strictly increases", test_monotonicity());
 
     printf("\nF003: Multiple clock sources\n");
-    print_test("  All clocks accessible", test_multiple_clocks());
+    vdso_results_scope("F003", ACCURACY_SAMPLES);
+    print_test("  Every clock within its syscall bracket", test_clock_ids());
 
     printf("\nF004: Time advancement\n");
+    vdso_results_scope("F004", 1);
     print_test("  Time advances correctly", test_time_advances());
 
     printf("\nF005: Accuracy vs syscall\n");
+    vdso_results_scope("F005", 1);
     struct timespec ts_vdso, ts_syscall;
     clock_gettime_vdso(CLOCK_MONOTONIC, &ts_vdso);
     clock_gettime_syscall(CLOCK_MONOTONIC, &ts_syscall);
@@ -247,7 +365,7 @@ static void run_functional_tests(void)
 
 /* ==================== Performance Tests ==================== */
 
-static double measure_single_call_latency(void)
+static double measure_single_call_latency(struct vdso_hist *h)
 {
     struct timespec ts;
     uint64_t start, end, min_cycles = UINT64_MAX;
@@ -260,19 +378,26 @@ static double measure_single_call_latency(void)
 
     /* Measure */
     for (i = 0; i < 1000; i++) {
-        start = rdcycle();
+        start = vdso_timing_read();
         clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
-        end = rdcycle();
+        end = vdso_timing_read();
 
         uint64_t cycles = end - start;
         if (cycles < min_cycles)
             min_cycles = cycles;
+        vdso_hist_record(h, cycles);
     }
 
     return min_cycles;
 }
 
-static double measure_throughput(int iterations)
+/*
+ * Average cycles per call over @iterations back-to-back calls, timed as
+ * one batch so the two counter reads are spread over every call. With @h,
+ * a second pass brackets each call and records it into @h; those samples
+ * include the bracket's own cost, so only their shape compares.
+ */
+static double measure_throughput(int iterations, struct vdso_hist *h)
 {
     struct timespec ts;
     uint64_t start, end;
@@ -283,53 +408,107 @@ static double measure_throughput(int iterations)
         clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
     }
 
-    start = rdcycle();
+    start = vdso_timing_read();
     for (i = 0; i < iterations; i++) {
         clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
     }
-    end = rdcycle();
+    end = vdso_timing_read();
 
     double total_cycles = end - start;
     double avg_cycles = total_cycles / iterations;
 
+    if (h) {
+        for (i = 0; i < iterations; i++) {
+            uint64_t t0 = vdso_timing_read();
+            clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
+            uint64_t t1 = vdso_timing_read();
+
+            vdso_hist_record(h, t1 - t0);
+        }
+    }
+
     return avg_cycles;
 }
 
-static double estimate_cache_hit_rate(void)
+/* Per-call latency of @iterations back-to-back calls, into @h */
+static void measure_latency_hist(struct vdso_hist *h, int iterations)
 {
     struct timespec ts;
-    uint64_t fast_calls = 0, total_calls = 0;
-    uint64_t threshold = 100; /* cycles */
     int i;
 
-    /* Measure call latency distribution */
-    for (i = 0; i < 10000; i++) {
-        uint64_t start = rdcycle();
+    for (i = 0; i < iterations; i++) {
+        uint64_t start = vdso_timing_read();
         clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
-        uint64_t end = rdcycle();
+        uint64_t end = vdso_timing_read();
 
-        uint64_t cycles = end - start;
-        total_calls++;
-        if (cycles < threshold)
-            fast_calls++;
+        vdso_hist_record(h, end - start);
     }
+}
+
+/*
+ * Cache hit rate over 10000 calls. Exact when the vDSO exports its
+ * counters (@exact is set and @d filled), otherwise estimated from the
+ * share of calls faster than 100 cycles.
+ */
+static double estimate_cache_hit_rate(struct vdso_hist *h, bool *exact,
+                                      struct vdso_cache_stats *d)
+{
+    uint64_t threshold = 100; /* cycles */
+    struct vdso_cache_stats start, end;
+
+    *exact = vdso_cache_stats_read(&start);
+
+    /* Measure call latency distribution */
+    measure_latency_hist(h, 10000);
 
-    return (double)fast_calls / total_calls * 100.0;
+    if (*exact && vdso_cache_stats_read(&end)) {
+        vdso_cache_stats_delta(&start, &end, d);
+        return vdso_cache_stats_hit_rate(d);
+    }
+    *exact = false;
+    return (double)vdso_hist_count_below(h, threshold) / h->count * 100.0;
 }
 
 static void run_performance_tests(void)
 {
-    double cpu_freq_mhz = get_cpu_freq_mhz();
+    struct vdso_hist *hist = vdso_hist_alloc();
+    struct vdso_breakdown bd;
+    struct vdso_perf perf;
+    struct vdso_perf_counts pc;
+    double uncached;
+
+    if (!hist || vdso_breakdown_measure(&bd, clock_gettime_vdso) < 0) {
+        perror(hist ? "vdso_breakdown_measure" : "vdso_hist_alloc");
+        vdso_hist_free(hist);
+        tests_skipped++;
+        return;
+    }
 
     print_header("Performance Tests (P001-P006)");
+    vdso_calib_refresh();
+
+    /* Uncached baseline measured on this hart rather than assumed */
+    printf("\nCost attribution (median per call)\n");
+    vdso_results_scope("breakdown", VDSO_BD_SAMPLES * VDSO_BD_BATCH);
+    vdso_breakdown_print(&bd, "  ");
+    vdso_breakdown_emit(&bd);
+    uncached = vdso_breakdown_uncached(&bd);
+
+    /* Trap counts per phase; calls include each phase's warmup */
+    if (!vdso_perf_open(&perf))
+        printf("\n  " COLOR_YELLOW "perf counters unavailable, no trap counts" COLOR_RESET "\n");
 
     /* P001: Single call latency */
     printf("\nP001: Single call latency\n");
-    double latency_cycles = measure_single_call_latency();
-    double latency_ns = latency_cycles / cpu_freq_mhz;
+    vdso_results_scope("P001", 1000);
+    vdso_perf_begin(&perf);
+    double latency_cycles = measure_single_call_latency(hist);
+    vdso_perf_end(&perf, &pc);
+    vdso_perf_report(&pc, WARMUP_ITERATIONS + 1000, "  • ");
 
+    /* Also records P001.min_latency_ns */
     print_value("  Min latency", latency_cycles, "cycles");
-    print_value("  Min latency", latency_ns, "ns");
+    print_hist("  ", hist, "cycles");
 
     bool latency_ok = latency_cycles < 100; /* Expect < 100 cycles with cache */
     print_test("  Latency acceptable (< 100 cycles)", latency_ok);
@@ -341,12 +520,25 @@ static void run_performance_tests(void)
     const char *freq_names[] = {"High (1M/s)", "Medium (100k/s)", "Low (10k/s)"};
 
     for (int i = 0; i < 3; i++) {
-        double avg_cycles = measure_throughput(freqs[i]);
-        double improvement = 250.0 / avg_cycles; /* Baseline ~250 cycles */
+        char scope[8];
+
+        snprintf(scope, sizeof(scope), "P%03d", i + 2);
+        vdso_results_scope(scope, freqs[i]);
+        vdso_hist_reset(hist);
+        vdso_perf_begin(&perf);
+        double avg_cycles = measure_throughput(freqs[i], hist);
+        double improvement = uncached / avg_cycles;
+        vdso_perf_end(&perf, &pc);
 
         printf("  %s:\n", freq_names[i]);
         print_value("    Avg cycles", avg_cycles, "cycles");
+        print_value("    Avg latency", vdso_cycles_to_ns(avg_cycles), "ns");
+        print_value("    Rate", vdso_cycles_to_rate(avg_cycles), "calls/sec");
         print_value("    Speedup", improvement, "x");
+        /* The histogram pass repeats the batch */
+        vdso_perf_report(&pc, WARMUP_ITERATIONS + 2 * freqs[i], "    • ");
+
+        print_hist("    ", hist, "cycles");
 
         bool perf_ok = avg_cycles < 100;
         print_test("    Performance acceptable", perf_ok);
@@ -354,73 +546,328 @@ static void run_performance_tests(void)
 
     /* P005: AI inference simulation */
     printf("\nP005: AI inference workload simulation\n");
+    vdso_results_scope("P005", 10000);
     struct timespec ts;
     uint64_t total_cycles = 0;
     int iterations = 10000;
 
+    vdso_hist_reset(hist);
+    vdso_perf_begin(&perf);
     for (int i = 0; i < iterations; i++) {
-        uint64_t start = rdcycle();
+        uint64_t start = vdso_timing_read();
         clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
         /* Simulate inference work */
         volatile int j;
         for (j = 0; j < 100; j++);
         clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
-        uint64_t end = rdcycle();
+        uint64_t end = vdso_timing_read();
         total_cycles += (end - start);
+        vdso_hist_record(hist, end - start);
     }
 
+    vdso_perf_end(&perf, &pc);
+
     double avg_inference_cycles = (double)total_cycles / iterations;
-    double baseline_inference_cycles = 500; /* Estimated baseline */
+    /* Same loop with both reads paying the uncached cost */
+    double baseline_inference_cycles = avg_inference_cycles +
+                                       2 * (uncached - bd.vdso);
     double improvement = baseline_inference_cycles / avg_inference_cycles;
+    /* The same loop if both reads hit: drop the counter reads it still paid */
+    double hit_inference_cycles = avg_inference_cycles -
+                                  2 * vdso_breakdown_reads_per_call(&bd) * bd.counter;
+    double expected = hit_inference_cycles > 0 ?
+                      baseline_inference_cycles / hit_inference_cycles : 1.0;
 
     print_value("  Avg inference cycles", avg_inference_cycles, "cycles");
     print_value("  Estimated speedup", improvement, "x");
+    print_value("  Speedup if every read hits", expected, "x");
+    vdso_perf_report(&pc, 2 * iterations, "  • ");
+    print_hist("  ", hist, "cycles");
 
-    bool ai_perf_ok = improvement >= 3.0;
+    /* At least half of the gain the breakdown allows for this loop */
+    bool ai_perf_ok = improvement >= 1.0 + (expected - 1.0) / 2;
     print_test("  AI inference performance improved", ai_perf_ok);
 
     /* P006: Cache hit rate */
     printf("\nP006: Cache hit rate estimation\n");
-    double hit_rate = estimate_cache_hit_rate();
-    print_value("  Estimated cache hit rate", hit_rate, "%");
+    vdso_results_scope("P006", 10000);
+    vdso_hist_reset(hist);
+    struct vdso_cache_stats d;
+    bool exact;
+    vdso_perf_begin(&perf);
+    double hit_rate = estimate_cache_hit_rate(hist, &exact, &d);
+    vdso_perf_end(&perf, &pc);
+    if (exact) {
+        print_value("  Cache hits", d.hits, "count");
+        print_value("  Cache misses", d.misses, "count");
+        print_value("  Invalidations", d.invalidations, "count");
+        print_value("  Cache hit rate", hit_rate, "%");
+    } else {
+        print_value("  Estimated cache hit rate", hit_rate, "%");
+    }
+    vdso_perf_report(&pc, 10000, "  • ");
+    print_hist("  ", hist, "cycles");
 
     bool cache_ok = hit_rate >= 50.0;
     print_test("  Cache effective (≥ 50% hit rate)", cache_ok);
+
+    vdso_perf_close(&perf);
+    vdso_hist_free(hist);
 }
 
 /* ==================== Accuracy Tests ==================== */
 
+/*
+ * A005: fill the cache, wait, then read the vDSO right after a syscall.
+ * A fresh read is never earlier than the syscall before it, so the
+ * difference is how stale the served value was. Waits span from well
+ * inside to well past the window.
+ */
+static void test_staleness_bound(void)
+{
+    static const double waits[] = { 0, 0.25, 0.5, 1, 2, 4, 16 };
+    struct vdso_hist *h;
+    struct timespec fill, now, before, ts;
+    long bound = staleness_bound_ns();
+    int64_t max_stale = 0;
+
+    printf("\nA005: Cache staleness bound\n");
+    vdso_results_scope("A005", STALENESS_SAMPLES * 7);
+
+    if (bound < 0) {
+        printf("  " COLOR_YELLOW "No CONFIG_RISCV_VDSO_TIME_CACHE_WINDOW_NS, skipping" COLOR_RESET "\n");
+        tests_skipped++;
+        return;
+    }
+    if (bound == 0) {
+        printf("  " COLOR_YELLOW "Staleness window disabled (0), skipping" COLOR_RESET "\n");
+        tests_skipped++;
+        return;
+    }
+    /* The kernel only arms the window while user-mode rdcycle is granted */
+    if (!vdso_timing_counter_usable()) {
+        printf("  " COLOR_YELLOW "User-mode cycle counter not granted, window inactive, skipping"
+               COLOR_RESET "\n");
+        tests_skipped++;
+        return;
+    }
+
+    h = vdso_hist_alloc();
+    if (!h) {
+        perror("vdso_hist_alloc");
+        tests_skipped++;
+        return;
+    }
+
+    for (unsigned int w = 0; w < sizeof(waits) / sizeof(waits[0]); w++) {
+        int64_t wait_ns = (int64_t)(waits[w] * bound);
+
+        for (int i = 0; i < STALENESS_SAMPLES; i++) {
+            clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
+            clock_gettime_syscall(CLOCK_MONOTONIC, &fill);
+            do {
+                clock_gettime_syscall(CLOCK_MONOTONIC, &now);
+            } while (ts_diff_ns(&now, &fill) < wait_ns);
+
+            clock_gettime_syscall(CLOCK_MONOTONIC, &before);
+            clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
+
+            int64_t stale = ts_diff_ns(&before, &ts);
+
+            if (stale < 0)
+                stale = 0;
+            if (stale > max_stale)
+                max_stale = stale;
+            vdso_hist_record(h, stale);
+        }
+    }
+
+    print_value("  Staleness bound", bound, "ns");
+    print_value("  Max staleness", max_stale, "ns");
+    printf("  • Staleness percentiles (%lu samples):\n", (unsigned long)h->count);
+    vdso_hist_print_percentiles(h, "      ", "ns", 0);
+    vdso_results_emit("staleness p99", vdso_hist_percentile(h, 99.0), "ns", -1);
+
+    /* 10% slack for the boot-time cycles-per-ns conversion under DVFS */
+    print_test("  Staleness within bound", max_stale <= bound + bound / 10);
+    vdso_hist_free(h);
+}
+
+/* Timebase tick period: calibrated tick rate, else device tree, else 1ns */
+static double timebase_tick_ns(void)
+{
+    const struct vdso_calib_hart *h = vdso_calib_get(sched_getcpu());
+    uint32_t hz;
+
+    if (h && h->ticks_per_ns > 0)
+        return 1.0 / h->ticks_per_ns;
+    hz = vdso_calib_dt_timebase_hz();
+    return hz ? 1e9 / hz : 1.0;
+}
+
+static void spin_cycles(uint64_t cycles)
+{
+    uint64_t start = vdso_timing_read();
+
+    while (vdso_timing_read() - start < cycles)
+        ;
+}
+
+/*
+ * A006: with the monotonic-advance mode, cache hits must not repeat the
+ * previous timestamp. Back-to-back calls can only be distinct to one
+ * timebase tick, so repeats there are reported but not failed; calls
+ * spaced two ticks apart (normally still inside the cache window) must
+ * strictly increase.
+ */
+static void test_strict_increase(void)
+{
+    const struct vdso_calib_hart *h = vdso_calib_get(sched_getcpu());
+    double tick_ns = timebase_tick_ns();
+    uint64_t gap = h ? (uint64_t)(2 * tick_ns * h->cycles_per_ns) : 0;
+    struct timespec prev, curr;
+    int repeats = 0, spaced_repeats = 0, backwards = 0;
+
+    printf("\nA006: Strict increase of consecutive reads\n");
+    vdso_results_scope("A006", STRICT_SAMPLES);
+
+    clock_gettime_vdso(CLOCK_MONOTONIC, &prev);
+    for (int i = 0; i < STRICT_SAMPLES; i++) {
+        clock_gettime_vdso(CLOCK_MONOTONIC, &curr);
+        int64_t d = ts_diff_ns(&curr, &prev);
+
+        if (d == 0)
+            repeats++;
+        else if (d < 0)
+            backwards++;
+        prev = curr;
+    }
+
+    clock_gettime_vdso(CLOCK_MONOTONIC, &prev);
+    for (int i = 0; i < STRICT_SAMPLES; i++) {
+        spin_cycles(gap);
+        clock_gettime_vdso(CLOCK_MONOTONIC, &curr);
+        int64_t d = ts_diff_ns(&curr, &prev);
+
+        if (d == 0)
+            spaced_repeats++;
+        else if (d < 0)
+            backwards++;
+        prev = curr;
+    }
+
+    print_value("  Timebase tick", tick_ns, "ns");
+    print_value("  Back-to-back repeats", repeats, "count");
+    print_value("  Spaced (2 ticks) repeats", spaced_repeats, "count");
+    print_value("  Backward steps", backwards, "count");
+
+    print_test("  Strictly increasing at tick spacing",
+               spaced_repeats == 0 && backwards == 0);
+}
+
+/*
+ * A007: the hybrid clock interpolates CSR_TIME from rdcycle, so its error
+ * is bounded against syscall reads taken just before and after: a value
+ * outside [before, after] is off by its distance to the nearer edge.
+ * Spacing the samples out lets the interpolation run across whole ticks.
+ */
+static void test_hybrid_error(void)
+{
+    static const clockid_t clocks[] = { CLOCK_MONOTONIC, CLOCK_REALTIME };
+    struct vdso_hist *h;
+    struct timespec before, hybrid, after;
+    int64_t max_err = 0;
+
+    printf("\nA007: Hybrid clock error vs syscall\n");
+    vdso_results_scope("A007", HYBRID_SAMPLES);
+
+    if (!vdso_hybrid_available()) {
+        printf("  " COLOR_YELLOW "__vdso_clock_gettime_hybrid not exported, skipping" COLOR_RESET "\n");
+        tests_skipped++;
+        return;
+    }
+
+    h = vdso_hist_alloc();
+    if (!h) {
+        perror("vdso_hist_alloc");
+        tests_skipped++;
+        return;
+    }
+
+    for (int i = 0; i < HYBRID_SAMPLES; i++) {
+        clockid_t clk = clocks[i % 2];
+        int64_t err = 0;
+
+        clock_gettime_syscall(clk, &before);
+        vdso_clock_gettime_hybrid(clk, &hybrid);
+        clock_gettime_syscall(clk, &after);
+
+        if (ts_diff_ns(&hybrid, &before) < 0)
+            err = ts_diff_ns(&before, &hybrid);
+        else if (ts_diff_ns(&after, &hybrid) < 0)
+            err = ts_diff_ns(&hybrid, &after);
+        if (err > max_err)
+            max_err = err;
+        vdso_hist_record(h, err);
+
+        if (i % 100 == 0)
+            usleep(i % 1000);
+    }
+
+    print_value("  Error bound", HYBRID_ERROR_NS, "ns");
+    print_value("  Max error", max_err, "ns");
+    printf("  • Error percentiles (%lu samples):\n", (unsigned long)h->count);
+    vdso_hist_print_percentiles(h, "      ", "ns", 0);
+    vdso_results_emit("hybrid error p99", vdso_hist_percentile(h, 99.0), "ns", -1);
+
+    print_test("  Hybrid error within bound", max_err <= HYBRID_ERROR_NS);
+    vdso_hist_free(h);
+}
+
 static void run_accuracy_tests(void)
 {
-    print_header("Accuracy Tests (A001-A004)");
+    print_header("Accuracy Tests (A001-A007)");
 
     /* A001: Absolute accuracy */
     printf("\nA001: Absolute accuracy vs syscall\n");
     struct timespec ts_vdso, ts_syscall;
-    int64_t abs_max_diff = 0, total_diff = 0;
     int i;
 
-    for (i = 0; i < ACCURACY_SAMPLES; i++) {
-        clock_gettime_vdso(CLOCK_MONOTONIC, &ts_vdso);
-        clock_gettime_syscall(CLOCK_MONOTONIC, &ts_syscall);
+    /* Every clock that reads the counter, i.e. every clock the cache serves */
+    for (unsigned int c = 0; c < VDSO_NR_CLOCK_IDS; c++) {
+        const struct vdso_clock_id *clk = &vdso_clock_ids[c];
+        int64_t abs_max_diff = 0, total_diff = 0;
+        char scope[32], name[48];
 
-        int64_t diff_ns = (ts_vdso.tv_sec - ts_syscall.tv_sec) * 1000000000 +
-                          (ts_vdso.tv_nsec - ts_syscall.tv_nsec);
+        if (!clk->counter)
+            continue;
+        snprintf(scope, sizeof(scope), "A001.%s", clk->name);
+        vdso_results_scope(scope, ACCURACY_SAMPLES);
 
-        if (llabs(diff_ns) > abs_max_diff)
-            abs_max_diff = llabs(diff_ns);
-        total_diff += llabs(diff_ns);
-    }
+        for (i = 0; i < ACCURACY_SAMPLES; i++) {
+            clock_gettime_vdso(clk->id, &ts_vdso);
+            clock_gettime_syscall(clk->id, &ts_syscall);
+
+            int64_t diff_ns = ts_diff_ns(&ts_vdso, &ts_syscall);
 
-    double avg_diff_ns = (double)total_diff / ACCURACY_SAMPLES;
-    print_value("  Max difference", abs_max_diff, "ns");
-    print_value("  Avg difference", avg_diff_ns, "ns");
+            if (llabs(diff_ns) > abs_max_diff)
+                abs_max_diff = llabs(diff_ns);
+            total_diff += llabs(diff_ns);
+        }
+
+        double avg_diff_ns = (double)total_diff / ACCURACY_SAMPLES;
+        printf("  %s:\n", clk->name);
+        print_value("  Max difference", abs_max_diff, "ns");
+        print_value("  Avg difference", avg_diff_ns, "ns");
 
-    bool abs_accuracy_ok = abs_max_diff < 1000; /* < 1μs */
-    print_test("  Absolute accuracy (< 1μs)", abs_accuracy_ok);
+        bool abs_accuracy_ok = abs_max_diff < 1000; /* < 1μs */
+        snprintf(name, sizeof(name), "  CLOCK_%s accuracy (< 1μs)", clk->name);
+        print_test(name, abs_accuracy_ok);
+    }
 
     /* A002: Relative accuracy (no negative intervals) */
     printf("\nA002: Relative accuracy (negative intervals)\n");
+    vdso_results_scope("A002", 10000);
     int negative_count = 0;
     struct timespec prev, curr;
 
@@ -442,6 +889,7 @@ static void run_accuracy_tests(void)
 
     /* A003: Sleep accuracy */
     printf("\nA003: Sleep timing accuracy\n");
+    vdso_results_scope("A003", 1);
     struct timespec ts1, ts2;
 
     clock_gettime_vdso(CLOCK_MONOTONIC, &ts1);
@@ -460,12 +908,13 @@ static void run_accuracy_tests(void)
 
     /* A004: Cache freshness */
     printf("\nA004: Cache freshness in rapid reads\n");
+    vdso_results_scope("A004", 100);
     uint64_t diffs[100];
 
     for (i = 0; i < 100; i++) {
-        uint64_t t1 = rdcycle();
+        uint64_t t1 = vdso_timing_read();
         clock_gettime_vdso(CLOCK_MONOTONIC, &ts_vdso);
-        uint64_t t2 = rdcycle();
+        uint64_t t2 = vdso_timing_read();
         diffs[i] = t2 - t1;
     }
 
@@ -482,6 +931,10 @@ static void run_accuracy_tests(void)
 
     bool freshness_ok = max_diff < 100;
     print_test("  Cache reads fast (< 100 cycles)", freshness_ok);
+
+    test_staleness_bound();
+    test_strict_increase();
+    test_hybrid_error();
 }
 
 /* ==================== Stress Tests ==================== */
@@ -497,21 +950,310 @@ static void sigalrm_handler(int sig)
 
 static void *stress_thread(void *arg)
 {
+    struct vdso_hist *h = arg;
     struct timespec ts;
     while (stress_running) {
+        uint64_t start = vdso_timing_read();
         if (clock_gettime_vdso(CLOCK_MONOTONIC, &ts) != 0) {
             longjmp(stress_jmp, 1);
         }
+        vdso_hist_record(h, vdso_timing_read() - start);
+    }
+    return NULL;
+}
+
+/*
+ * S004: invalidation storm. Every update_vsyscall() bumps clock_data[0].seq
+ * and so invalidates the time cache of every thread at once. A driver
+ * thread forces one update per STORM_PERIOD_NS, alternating an adjtimex()
+ * frequency slew and a clock_settime(CLOCK_REALTIME) step, while reader
+ * threads read MONOTONIC then REALTIME from the vDSO.
+ *
+ * Misses and latency are binned by time since the last bump, which shows
+ * the synchronized miss burst against the steady state. Misses come from
+ * the vDSO's own counters (vdso_cache_stats.h) when the kernel exports
+ * them. Otherwise they are estimated as calls slower than halfway between
+ * a hit and a trap, and reported as such. For staleness, the driver publishes
+ * REALTIME - MONOTONIC after each update under a sequence count; a reader
+ * pair that started after the publish must see that offset, and a value
+ * from before a step would be off by STORM_JUMP_NS.
+ *
+ * The test changes system-wide time, so it only runs with --storm. At the
+ * end the frequency is written back and REALTIME is set from MONOTONIC
+ * plus the offset recorded before the first update.
+ */
+static struct {
+    uint64_t seq;               /* odd while an update is in flight */
+    int64_t offset_ns;          /* REALTIME - MONOTONIC after the update */
+    int64_t bump_ns;            /* MONOTONIC when the update returned */
+    bool running;
+} storm;
+
+struct storm_reader {
+    pthread_t thread;
+    bool exact;                 /* misses from __vdso_time_cache_stats */
+    uint64_t threshold;         /* cycles; else slower calls count as misses */
+    uint64_t max_pair;          /* cycles; longer pairs are not checked */
+    uint64_t calls[STORM_BINS + 1];
+    uint64_t misses[STORM_BINS + 1];
+    uint64_t cycles[STORM_BINS + 1];
+    uint64_t max_cycles;        /* worst call within the burst bins */
+    uint64_t checked;
+    uint64_t stale;
+    int64_t worst_err_ns;
+};
+
+static int64_t ts_ns(const struct timespec *ts)
+{
+    return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+static int64_t storm_offset_syscall(void)
+{
+    struct timespec rt, mono;
+
+    clock_gettime_syscall(CLOCK_REALTIME, &rt);
+    clock_gettime_syscall(CLOCK_MONOTONIC, &mono);
+    return ts_ns(&rt) - ts_ns(&mono);
+}
+
+static void *storm_reader_thread(void *arg)
+{
+    struct storm_reader *r = arg;
+    struct timespec mono, rt;
+
+    while (__atomic_load_n(&storm.running, __ATOMIC_ACQUIRE)) {
+        uint64_t seq = __atomic_load_n(&storm.seq, __ATOMIC_ACQUIRE);
+        int64_t offset = storm.offset_ns, bump = storm.bump_ns, since, err;
+        struct vdso_cache_stats s0, s1;
+        uint64_t t0, t1, t2;
+        bool miss;
+        int bin;
+
+        if (r->exact)
+            vdso_cache_stats_read(&s0);
+        t0 = vdso_timing_read();
+        clock_gettime_vdso(CLOCK_MONOTONIC, &mono);
+        t1 = vdso_timing_read();
+        if (r->exact)
+            miss = vdso_cache_stats_read(&s1) && s1.misses != s0.misses;
+        else
+            miss = t1 - t0 >= r->threshold;
+        clock_gettime_vdso(CLOCK_REALTIME, &rt);
+        t2 = vdso_timing_read();
+
+        since = ts_ns(&mono) - bump;
+        bin = since >= 0 && since < (int64_t)STORM_BIN_NS * STORM_BINS ?
+              (int)(since / STORM_BIN_NS) : STORM_BINS;
+        r->calls[bin]++;
+        r->cycles[bin] += t1 - t0;
+        if (miss)
+            r->misses[bin]++;
+        if (bin < STORM_BINS && t1 - t0 > r->max_cycles)
+            r->max_cycles = t1 - t0;
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if ((seq & 1) || __atomic_load_n(&storm.seq, __ATOMIC_RELAXED) != seq ||
+            t2 - t0 > r->max_pair)
+            continue;
+
+        err = ts_ns(&rt) - ts_ns(&mono) - offset;
+        if (err < 0)
+            err = -err;
+        r->checked++;
+        if (err > r->worst_err_ns)
+            r->worst_err_ns = err;
+        if (err > STORM_TOLERANCE_NS)
+            r->stale++;
     }
     return NULL;
 }
 
+/* Force one timekeeping update; false if it was refused */
+static bool storm_bump(int n, const struct timex *orig)
+{
+    struct timespec mono;
+    bool ok;
+
+    __atomic_store_n(&storm.seq, storm.seq + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (n & 1) {
+        /* Step REALTIME, alternating forward and back so it nets out */
+        struct timespec rt;
+        int64_t t;
+
+        clock_gettime_syscall(CLOCK_REALTIME, &rt);
+        t = ts_ns(&rt) + ((n & 2) ? -STORM_JUMP_NS : STORM_JUMP_NS);
+        rt.tv_sec = t / 1000000000LL;
+        rt.tv_nsec = t % 1000000000LL;
+        ok = clock_settime(CLOCK_REALTIME, &rt) == 0;
+    } else {
+        struct timex tx = { .modes = ADJ_FREQUENCY };
+
+        tx.freq = orig->freq + ((n & 2) ? 0 : STORM_SLEW_PPM * 65536L);
+        ok = adjtimex(&tx) >= 0;
+    }
+    clock_gettime_syscall(CLOCK_MONOTONIC, &mono);
+    storm.offset_ns = storm_offset_syscall();
+    storm.bump_ns = ts_ns(&mono);
+    __atomic_store_n(&storm.seq, storm.seq + 1, __ATOMIC_RELEASE);
+    return ok;
+}
+
+static void test_invalidation_storm(void)
+{
+    struct storm_reader *readers;
+    struct vdso_breakdown bd;
+    struct timex orig = { .modes = 0 };
+    struct timespec start, now, next;
+    int nr = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    uint64_t calls[STORM_BINS + 1] = { 0 }, misses[STORM_BINS + 1] = { 0 };
+    uint64_t cycles[STORM_BINS + 1] = { 0 };
+    uint64_t max_cycles = 0, checked = 0, stale = 0, bumps = 0;
+    int64_t worst_err = 0, offset0;
+    double peak_rate = 0, steady_rate, secs = STORM_DURATION_NS / 1e9;
+    bool refused = false, exact = vdso_cache_stats_available();
+    int started;
+
+    printf("\nS004: Invalidation storm (adjtimex slew + clock_settime steps)\n");
+    vdso_results_scope("S004", 0);
+    if (!run_storm) {
+        printf("  " COLOR_YELLOW "Changes system time, run with --storm" COLOR_RESET "\n");
+        tests_skipped++;
+        return;
+    }
+
+    /* Read the current frequency, then write it back to probe CAP_SYS_TIME */
+    if (adjtimex(&orig) < 0) {
+        perror("adjtimex");
+        tests_skipped++;
+        return;
+    }
+    orig.modes = ADJ_FREQUENCY;
+    if (adjtimex(&orig) < 0) {
+        printf("  " COLOR_YELLOW "Needs CAP_SYS_TIME, skipping" COLOR_RESET "\n");
+        tests_skipped++;
+        return;
+    }
+    if (vdso_breakdown_measure(&bd, clock_gettime_vdso) < 0) {
+        perror("vdso_breakdown_measure");
+        tests_skipped++;
+        return;
+    }
+    if (nr < 1)
+        nr = 1;
+    if (nr > STORM_MAX_THREADS)
+        nr = STORM_MAX_THREADS;
+    readers = calloc(nr, sizeof(*readers));
+    if (!readers) {
+        perror("calloc");
+        tests_skipped++;
+        return;
+    }
+
+    offset0 = storm.offset_ns = storm_offset_syscall();
+    clock_gettime_syscall(CLOCK_MONOTONIC, &now);
+    storm.bump_ns = ts_ns(&now);
+    __atomic_store_n(&storm.running, true, __ATOMIC_RELEASE);
+    for (started = 0; started < nr; started++) {
+        struct storm_reader *r = &readers[started];
+
+        r->exact = exact;
+        r->threshold = (uint64_t)(vdso_breakdown_software(&bd) + bd.counter / 2);
+        r->max_pair = (uint64_t)(STORM_TOLERANCE_NS / 2 / vdso_cycles_to_ns(1.0));
+        if (pthread_create(&r->thread, NULL, storm_reader_thread, r) != 0) {
+            perror("pthread_create");
+            print_test("  Thread creation failed", false);
+            break;
+        }
+    }
+    nr = started;
+    if (!nr) {
+        __atomic_store_n(&storm.running, false, __ATOMIC_RELEASE);
+        free(readers);
+        return;
+    }
+
+    /* Driver: one update per period on an absolute schedule */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    next = start;
+    do {
+        int64_t t = ts_ns(&next) + STORM_PERIOD_NS;
+
+        next.tv_sec = t / 1000000000LL;
+        next.tv_nsec = t % 1000000000LL;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        refused |= !storm_bump((int)bumps++, &orig);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while (ts_ns(&now) - ts_ns(&start) < STORM_DURATION_NS);
+
+    __atomic_store_n(&storm.running, false, __ATOMIC_RELEASE);
+    for (int i = 0; i < nr; i++) {
+        pthread_join(readers[i].thread, NULL);
+        for (int b = 0; b <= STORM_BINS; b++) {
+            calls[b] += readers[i].calls[b];
+            misses[b] += readers[i].misses[b];
+            cycles[b] += readers[i].cycles[b];
+        }
+        if (readers[i].max_cycles > max_cycles)
+            max_cycles = readers[i].max_cycles;
+        checked += readers[i].checked;
+        stale += readers[i].stale;
+        if (readers[i].worst_err_ns > worst_err)
+            worst_err = readers[i].worst_err_ns;
+    }
+    free(readers);
+
+    /* Undo the slew, then put REALTIME back where MONOTONIC says it belongs */
+    adjtimex(&orig);
+    clock_gettime_syscall(CLOCK_MONOTONIC, &now);
+    {
+        int64_t t = ts_ns(&now) + offset0;
+
+        now.tv_sec = t / 1000000000LL;
+        now.tv_nsec = t % 1000000000LL;
+        if (clock_settime(CLOCK_REALTIME, &now) != 0)
+            perror("clock_settime (restore)");
+    }
+
+    /* Miss rate over all threads, per bin time summed over bumps */
+    for (int b = 0; b < STORM_BINS; b++) {
+        double rate = misses[b] / (bumps * STORM_BIN_NS / 1e9);
+
+        if (rate > peak_rate)
+            peak_rate = rate;
+    }
+    steady_rate = misses[STORM_BINS] /
+                  (secs - bumps * (double)STORM_BIN_NS * STORM_BINS / 1e9);
+
+    vdso_results_scope("S004", calls[0]);
+    print_value("  Reader threads", nr, "threads");
+    print_value("  Timekeeping updates", bumps, "updates");
+    printf("  • Misses: %s\n", exact ? "exact (vDSO time cache counters)" :
+           "estimated from latency (no __vdso_time_cache_stats)");
+    vdso_results_emit("exact misses", exact, "bool", -1);
+    print_value("  Peak miss rate after update", peak_rate, "misses/sec");
+    print_value("  Steady miss rate", steady_rate, "misses/sec");
+    print_value("  Mean latency, first bin",
+                calls[0] ? vdso_cycles_to_ns((double)cycles[0] / calls[0]) : 0, "ns");
+    print_value("  Mean latency, steady",
+                calls[STORM_BINS] ?
+                vdso_cycles_to_ns((double)cycles[STORM_BINS] / calls[STORM_BINS]) : 0, "ns");
+    print_value("  Max latency after update", vdso_cycles_to_ns(max_cycles), "ns");
+    print_value("  Offset checks", checked, "pairs");
+    print_value("  Worst offset error", worst_err, "ns");
+    if (refused)
+        printf("  " COLOR_YELLOW "Some updates were refused" COLOR_RESET "\n");
+    print_test("  No stale value across clock_settime", checked > 0 && stale == 0);
+}
+
 static void run_stress_tests(void)
 {
-    print_header("Stress Tests (S001-S003)");
+    print_header("Stress Tests (S001-S004)");
 
     /* S001: Sustained operation */
     printf("\nS001: Sustained operation (10 seconds)\n");
+    vdso_results_scope("S001", 0);
     stress_running = true;
     signal(SIGALRM, sigalrm_handler);
     alarm(STRESS_DURATION_SEC);
@@ -532,13 +1274,16 @@ static void run_stress_tests(void)
 
     alarm(0);
     signal(SIGALRM, SIG_DFL);
+    vdso_calib_refresh();
 
+    vdso_results_scope("S001", count);
     print_value("  Completed calls", count, "calls");
     print_value("  Rate", count / (double)STRESS_DURATION_SEC, "calls/sec");
     print_test("  No crashes during sustained operation", true);
 
     /* S002: Multi-process */
     printf("\nS002: Multi-process concurrent test\n");
+    vdso_results_scope("S002", 10 * 100000);
     int num_children = 10;
     pid_t pids[10];
     int i;
@@ -572,14 +1317,19 @@ static void run_stress_tests(void)
 
     /* S003: Thread safety */
     printf("\nS003: Multi-threaded test\n");
+    vdso_results_scope("S003", 0);
     const int max_threads = 10;
     pthread_t threads[max_threads];
+    struct vdso_hist *thread_hist[max_threads];
     int num_threads = max_threads;
 
     stress_running = true;
 
     for (i = 0; i < num_threads; i++) {
-        if (pthread_create(&threads[i], NULL, stress_thread, NULL) != 0) {
+        thread_hist[i] = vdso_hist_alloc();
+        if (!thread_hist[i] ||
+            pthread_create(&threads[i], NULL, stress_thread, thread_hist[i]) != 0) {
+            vdso_hist_free(thread_hist[i]);
             perror("pthread_create");
             print_test("  Thread creation failed", false);
             num_threads = i;
@@ -592,13 +1342,616 @@ static void run_stress_tests(void)
     stress_running = false;
 
     bool threads_ok = true;
+    struct vdso_hist *merged = vdso_hist_alloc();
     for (i = 0; i < num_threads; i++) {
         if (pthread_join(threads[i], NULL) != 0) {
             threads_ok = false;
         }
+        if (merged)
+            vdso_hist_merge(merged, thread_hist[i]);
+        vdso_hist_free(thread_hist[i]);
     }
 
+    if (merged) {
+        vdso_results_scope("S003", merged->count);
+        print_hist("", merged, "cycles");
+        vdso_hist_free(merged);
+    }
     print_test("  All threads completed successfully", threads_ok);
+
+    test_invalidation_storm();
+}
+
+/* ==================== Robustness Tests ==================== */
+
+/*
+ * The TLS time cache is a static __thread variable inside the vDSO, so its
+ * state follows whatever the thread pointer addresses: a copy after fork(),
+ * the parent's own block during vfork(), a fresh block after exec, the
+ * interrupted context's block in a signal handler, and whatever a runtime
+ * set up for threads it created itself. Each case must still return times
+ * inside a [syscall before, syscall after] bracket.
+ */
+static int64_t robust_tolerance_ns(void)
+{
+    long bound = staleness_bound_ns();
+
+    return 1000 + (bound > 0 ? bound : 0);
+}
+
+/* R003: body of the re-executed image ("--exec-child") */
+static int exec_child(void)
+{
+    int64_t tolerance = robust_tolerance_ns();
+
+    for (int i = 0; i < ROBUST_READS; i++) {
+        if (bracket_error_ns(clock_gettime_vdso, CLOCK_MONOTONIC) > tolerance)
+            return 1;
+    }
+    return 0;
+}
+
+struct fork_result {
+    int64_t first_ns;           /* first read in the child */
+    uint64_t first_cycles;
+    int64_t max_err_ns;
+};
+
+/*
+ * R001: the child starts with a copy of the parent's cache, filled under
+ * a generation the kernel may have moved past by the time the child runs.
+ */
+static void test_fork_tls(void)
+{
+    struct fork_result *res;
+    struct vdso_hist *h = vdso_hist_alloc();
+    int64_t tolerance = robust_tolerance_ns(), max_err = 0;
+    int backward = 0, failed = 0;
+
+    printf("\nR001: fork() with a warm cache (%d children)\n", ROBUST_FORKS);
+    vdso_results_scope("R001", ROBUST_FORKS);
+
+    res = mmap(NULL, ROBUST_FORKS * sizeof(*res), PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (res == MAP_FAILED || !h) {
+        perror("mmap");
+        vdso_hist_free(h);
+        tests_skipped++;
+        return;
+    }
+
+    for (int i = 0; i < ROBUST_FORKS; i++) {
+        struct timespec ts;
+        int64_t parent_ns;
+        int status;
+        pid_t pid;
+
+        clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
+        parent_ns = ts_ns(&ts);
+        pid = fork();
+        if (pid == 0) {
+            uint64_t t0 = vdso_timing_read();
+
+            clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
+            res[i].first_cycles = vdso_timing_read() - t0;
+            res[i].first_ns = ts_ns(&ts);
+            for (int j = 0; j < ROBUST_READS; j++) {
+                int64_t err = bracket_error_ns(clock_gettime_vdso, CLOCK_MONOTONIC);
+
+                if (err > res[i].max_err_ns)
+                    res[i].max_err_ns = err;
+            }
+            _exit(0);
+        }
+        if (pid < 0) {
+            perror("fork");
+            failed++;
+            break;
+        }
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0) {
+            failed++;
+            continue;
+        }
+        if (res[i].first_ns < parent_ns)
+            backward++;
+        if (res[i].max_err_ns > max_err)
+            max_err = res[i].max_err_ns;
+        vdso_hist_record(h, res[i].first_cycles);
+    }
+
+    print_value("  Child first call p50", vdso_hist_percentile(h, 50.0), "cycles");
+    print_value("  Child first call max", h->max, "cycles");
+    print_value("  Max error outside bracket", max_err, "ns");
+    print_value("  First read before parent's last", backward, "count");
+    print_test("  Children read correct time after fork()",
+               failed == 0 && backward == 0 && max_err <= tolerance);
+
+    munmap(res, ROBUST_FORKS * sizeof(*res));
+    vdso_hist_free(h);
+}
+
+/*
+ * R002: a vfork() child runs on the parent's thread pointer, so its reads
+ * fill the parent's own cache before the parent resumes.
+ */
+static volatile int64_t vfork_child_ns;
+
+static void test_vfork_tls(void)
+{
+    int64_t tolerance = robust_tolerance_ns(), max_err = 0;
+    int backward = 0, failed = 0;
+
+    printf("\nR002: vfork() sharing the parent's TLS (%d children)\n", ROBUST_FORKS);
+    vdso_results_scope("R002", ROBUST_FORKS);
+
+    for (int i = 0; i < ROBUST_FORKS; i++) {
+        struct timespec ts;
+        int64_t before_ns, err;
+        int status;
+        pid_t pid;
+
+        clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
+        before_ns = ts_ns(&ts);
+        pid = vfork();
+        if (pid == 0) {
+            struct timespec cts;
+
+            clock_gettime_vdso(CLOCK_MONOTONIC, &cts);
+            vfork_child_ns = ts_ns(&cts);
+            _exit(0);
+        }
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)) {
+            failed++;
+            continue;
+        }
+        clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
+        if (vfork_child_ns < before_ns || ts_ns(&ts) < vfork_child_ns)
+            backward++;
+        err = bracket_error_ns(clock_gettime_vdso, CLOCK_MONOTONIC);
+        if (err > max_err)
+            max_err = err;
+    }
+
+    print_value("  Max error outside bracket", max_err, "ns");
+    print_value("  Backward steps around child", backward, "count");
+    print_test("  Parent and child agree across vfork()",
+               failed == 0 && backward == 0 && max_err <= tolerance);
+}
+
+/* R003: a fresh image gets a fresh, zeroed cache */
+static void test_exec_tls(void)
+{
+    int failed = 0;
+
+    printf("\nR003: fork() + exec (%d children)\n", ROBUST_EXECS);
+    vdso_results_scope("R003", ROBUST_EXECS);
+
+    for (int i = 0; i < ROBUST_EXECS; i++) {
+        int status;
+        pid_t pid = fork();
+
+        if (pid == 0) {
+            execl("/proc/self/exe", "vdso_cache_test", "--exec-child", (char *)NULL);
+            _exit(127);
+        }
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0)
+            failed++;
+    }
+
+    print_value("  Failed children", failed, "count");
+    print_test("  Exec'd children read correct time", failed == 0);
+}
+
+/*
+ * R004: SIGALRM at ROBUST_SIGNAL_HZ reads the clock from the handler, so
+ * some handler reads land in the middle of the interrupted read, slow
+ * path included. A handler fill then races the interrupted fill for the
+ * same cache. Neither context may see time go backwards relative to
+ * what the other has already returned.
+ */
+static struct vdso_hist *sig_hist;
+static volatile int64_t sig_last_ns, main_last_ns;
+static volatile uint64_t sig_backward;
+
+static void robust_sigalrm(int sig)
+{
+    struct timespec ts;
+    uint64_t t0 = vdso_timing_read();
+    int64_t v;
+
+    (void)sig;
+    clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
+    vdso_hist_record(sig_hist, vdso_timing_read() - t0);
+    v = ts_ns(&ts);
+    if (v < main_last_ns)
+        sig_backward++;
+    sig_last_ns = v;
+}
+
+/* Spin reading for @seconds; returns backward steps seen by the loop */
+static uint64_t signal_loop(struct vdso_hist *h, double seconds, uint64_t *calls,
+                            struct vdso_cache_stats *cs, bool *exact)
+{
+    struct vdso_cache_stats start, end;
+    struct timespec ts;
+    int64_t prev = 0, deadline;
+    uint64_t backward = 0;
+
+    *exact = vdso_cache_stats_read(&start);
+    clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
+    deadline = ts_ns(&ts) + (int64_t)(seconds * 1e9);
+    *calls = 0;
+    do {
+        int64_t seen = sig_last_ns, v;
+        uint64_t t0 = vdso_timing_read();
+
+        clock_gettime_vdso(CLOCK_MONOTONIC, &ts);
+        vdso_hist_record(h, vdso_timing_read() - t0);
+        v = ts_ns(&ts);
+        if (v < seen || v < prev)
+            backward++;
+        main_last_ns = prev = v;
+        (*calls)++;
+    } while (prev < deadline);
+
+    if (*exact && vdso_cache_stats_read(&end))
+        vdso_cache_stats_delta(&start, &end, cs);
+    else
+        *exact = false;
+    return backward;
+}
+
+static void test_signal_reentry(void)
+{
+    struct itimerval it = {
+        .it_interval = { 0, 1000000 / ROBUST_SIGNAL_HZ },
+        .it_value = { 0, 1000000 / ROBUST_SIGNAL_HZ },
+    };
+    struct itimerval off = { 0 };
+    struct sigaction sa, old;
+    struct vdso_hist *base = vdso_hist_alloc(), *loaded = vdso_hist_alloc();
+    struct vdso_cache_stats cs_base, cs_loaded;
+    uint64_t calls_base, calls_loaded, backward;
+    bool exact_base, exact_loaded;
+
+    printf("\nR004: Clock reads from a %d Hz SIGALRM handler\n", ROBUST_SIGNAL_HZ);
+    vdso_results_scope("R004", 0);
+
+    sig_hist = vdso_hist_alloc();
+    if (!base || !loaded || !sig_hist) {
+        perror("vdso_hist_alloc");
+        tests_skipped++;
+        goto out;
+    }
+
+    /* Baseline without signals, then the same loop under the timer */
+    signal_loop(base, ROBUST_SIGNAL_SEC, &calls_base, &cs_base, &exact_base);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = robust_sigalrm;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGALRM, &sa, &old);
+    sig_last_ns = main_last_ns = 0;
+    sig_backward = 0;
+    setitimer(ITIMER_REAL, &it, NULL);
+    backward = signal_loop(loaded, ROBUST_SIGNAL_SEC, &calls_loaded, &cs_loaded,
+                           &exact_loaded);
+    setitimer(ITIMER_REAL, &off, NULL);
+    sigaction(SIGALRM, &old, NULL);
+    vdso_calib_refresh();
+
+    vdso_results_scope("R004", calls_loaded);
+    print_value("  Handler reads", sig_hist->count, "calls");
+    print_value("  Handler latency p50", vdso_hist_percentile(sig_hist, 50.0), "cycles");
+    print_value("  Handler latency p99", vdso_hist_percentile(sig_hist, 99.0), "cycles");
+    print_value("  Loop latency p99, no signals", vdso_hist_percentile(base, 99.0), "cycles");
+    print_value("  Loop latency p99, with signals", vdso_hist_percentile(loaded, 99.0), "cycles");
+    print_value("  Loop rate, no signals", calls_base / (double)ROBUST_SIGNAL_SEC, "calls/sec");
+    print_value("  Loop rate, with signals", calls_loaded / (double)ROBUST_SIGNAL_SEC, "calls/sec");
+    if (exact_base && exact_loaded) {
+        print_value("  Misses/sec, no signals", cs_base.misses / (double)ROBUST_SIGNAL_SEC, "1/s");
+        print_value("  Misses/sec, with signals",
+                    cs_loaded.misses / (double)ROBUST_SIGNAL_SEC, "1/s");
+    }
+    print_value("  Backward steps (loop)", backward, "count");
+    print_value("  Backward steps (handler)", sig_backward, "count");
+    print_test("  No backward time between handler and interrupted code",
+               sig_hist->count > 0 && backward == 0 && sig_backward == 0);
+
+out:
+    vdso_hist_free(sig_hist);
+    sig_hist = NULL;
+    vdso_hist_free(loaded);
+    vdso_hist_free(base);
+}
+
+/*
+ * R005: threads created with raw clone(CLONE_SETTLS), as language runtimes
+ * do, with a thread pointer the C library never laid out. The thread calls
+ * the vDSO entry point directly, since libc functions may use TLS.
+ */
+typedef int (*robust_gettime_fn)(clockid_t, struct timespec *);
+
+struct clone_arg {
+    robust_gettime_fn gettime;
+    int64_t max_err_ns;
+};
+
+static ROBUST_NO_SSP int robust_clone_fn(void *p)
+{
+    struct clone_arg *a = p;
+
+    for (int i = 0; i < ROBUST_READS; i++) {
+        int64_t err = bracket_error_ns(a->gettime, CLOCK_MONOTONIC);
+
+        if (err > a->max_err_ns)
+            a->max_err_ns = err;
+    }
+    return 0;
+}
+
+static robust_gettime_fn robust_vdso_gettime(void)
+{
+    static const char *const names[] = { "__vdso_clock_gettime", "__kernel_clock_gettime" };
+    void *h = dlopen("linux-vdso.so.1", RTLD_NOW | RTLD_NOLOAD);
+
+    for (unsigned int i = 0; h && i < sizeof(names) / sizeof(names[0]); i++) {
+        void *fn = dlsym(h, names[i]);
+
+        if (fn)
+            return (robust_gettime_fn)fn;
+    }
+    return NULL;
+}
+
+/* Run robust_clone_fn in a clone thread with thread pointer @tls */
+static int robust_clone(struct clone_arg *a, void *tls)
+{
+    char *stack = malloc(ROBUST_STACK_SIZE);
+    pid_t ptid, ctid = 1;
+
+    if (!stack)
+        return -1;
+    if (clone(robust_clone_fn, stack + ROBUST_STACK_SIZE,
+              CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD |
+              CLONE_SYSVSEM | CLONE_SETTLS | CLONE_PARENT_SETTID |
+              CLONE_CHILD_CLEARTID, a, &ptid, tls, &ctid) < 0) {
+        free(stack);
+        return -1;
+    }
+    /* CLONE_CHILD_CLEARTID zeroes ctid and wakes us when the thread exits */
+    while (__atomic_load_n(&ctid, __ATOMIC_ACQUIRE) != 0)
+        syscall(SYS_futex, &ctid, FUTEX_WAIT, ctid, NULL, NULL, 0);
+    free(stack);
+    return 0;
+}
+
+static void test_custom_tls(void)
+{
+    struct clone_arg a = { .gettime = robust_vdso_gettime() };
+    unsigned char *area;
+    long changed = 0, lo = 0, hi = 0;
+    bool ok, null_ok;
+    int status;
+    pid_t pid;
+
+    printf("\nR005: clone() threads with a custom thread pointer\n");
+    vdso_results_scope("R005", ROBUST_READS);
+    if (!a.gettime) {
+        printf("  " COLOR_YELLOW "vDSO clock_gettime symbol not found, skipping" COLOR_RESET "\n");
+        tests_skipped++;
+        return;
+    }
+
+    /* Patterned block with the thread pointer in the middle, for both TLS variants */
+    area = malloc(ROBUST_TLS_AREA);
+    if (!area) {
+        perror("malloc");
+        tests_skipped++;
+        return;
+    }
+    memset(area, 0xa5, ROBUST_TLS_AREA);
+    ok = robust_clone(&a, area + ROBUST_TLS_AREA / 2) == 0 &&
+         a.max_err_ns <= robust_tolerance_ns();
+    for (long i = 0; i < ROBUST_TLS_AREA; i++) {
+        if (area[i] == 0xa5)
+            continue;
+        if (!changed++)
+            lo = i - ROBUST_TLS_AREA / 2;
+        hi = i - ROBUST_TLS_AREA / 2;
+    }
+    free(area);
+
+    print_value("  Max error outside bracket", a.max_err_ns, "ns");
+    print_value("  Bytes written around thread pointer", changed, "bytes");
+    if (changed)
+        printf("    at tp%+ld .. tp%+ld\n", lo, hi);
+    print_test("  Correct time with a foreign TLS block", ok);
+
+    /*
+     * A NULL thread pointer, in a child process: the TLS time cache is
+     * tp-relative, so on such a kernel the thread faults. That is the
+     * expected outcome, not a failure; only a wrong time is.
+     */
+    pid = fork();
+    if (pid == 0) {
+        a.max_err_ns = 0;
+        _exit(robust_clone(&a, NULL) == 0 && a.max_err_ns <= robust_tolerance_ns() ? 0 : 1);
+    }
+    if (pid < 0 || waitpid(pid, &status, 0) <= 0) {
+        perror(pid < 0 ? "fork" : "waitpid");
+        tests_skipped++;
+        return;
+    }
+    if (WIFSIGNALED(status)) {
+        printf("    thread with tp = 0 died with signal %d (expected with a TLS time cache)\n",
+               WTERMSIG(status));
+        vdso_results_emit("tp0 faulted", 1, "bool", -1);
+        return;
+    }
+    null_ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    print_test("  Correct time with no TLS (tp = 0)", null_ok);
+}
+
+static void run_robustness_tests(void)
+{
+    print_header("Robustness Tests (R001-R005)");
+
+    test_fork_tls();
+    test_vfork_tls();
+    test_exec_tls();
+    test_signal_reentry();
+    test_custom_tls();
+}
+
+/* ==================== Scaling Tests ==================== */
+
+/*
+ * One worker per hart runs the measure_throughput() loop concurrently. If
+ * the CSR_TIME trap is serialized in M-mode firmware, per-hart latency grows
+ * with the thread count and the aggregate rate stops scaling; with the TLS
+ * time cache most calls never reach the firmware.
+ */
+struct scaling_worker {
+    pthread_t thread;
+    pthread_barrier_t *barrier;
+    int cpu;
+    bool pinned;
+    double avg_cycles;
+    double elapsed_sec;
+};
+
+static void *scaling_thread(void *arg)
+{
+    struct scaling_worker *w = arg;
+    struct timespec t1, t2;
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu, &set);
+    w->pinned = sched_setaffinity(0, sizeof(set), &set) == 0;
+
+    pthread_barrier_wait(w->barrier);
+
+    clock_gettime_syscall(CLOCK_MONOTONIC, &t1);
+    w->avg_cycles = measure_throughput(SCALING_ITERATIONS, NULL);
+    clock_gettime_syscall(CLOCK_MONOTONIC, &t2);
+
+    w->elapsed_sec = (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9;
+    return NULL;
+}
+
+/* Run @nr workers pinned to the first @nr online harts, returns calls/sec */
+static double run_scaling_step(const int *cpus, int nr)
+{
+    struct scaling_worker *workers = calloc(nr, sizeof(*workers));
+    pthread_barrier_t barrier;
+    double max_elapsed = 0, rate;
+    bool pinned = true;
+    int i, started;
+
+    if (!workers)
+        return 0;
+
+    pthread_barrier_init(&barrier, NULL, nr);
+    for (started = 0; started < nr; started++) {
+        workers[started].barrier = &barrier;
+        workers[started].cpu = cpus[started];
+        if (pthread_create(&workers[started].thread, NULL, scaling_thread,
+                           &workers[started]) != 0) {
+            perror("pthread_create");
+            break;
+        }
+    }
+
+    /* Barrier was sized for @nr; cannot release a partial set */
+    if (started != nr) {
+        fprintf(stderr, "scaling: only %d of %d threads started\n", started, nr);
+        exit(1);
+    }
+
+    for (i = 0; i < nr; i++) {
+        pthread_join(workers[i].thread, NULL);
+        if (workers[i].elapsed_sec > max_elapsed)
+            max_elapsed = workers[i].elapsed_sec;
+        pinned &= workers[i].pinned;
+    }
+    pthread_barrier_destroy(&barrier);
+
+    /* measure_throughput() warms up inside the timed window */
+    rate = max_elapsed > 0 ?
+           (double)(SCALING_ITERATIONS + WARMUP_ITERATIONS) * nr / max_elapsed : 0;
+
+    char scope[32];
+
+    snprintf(scope, sizeof(scope), "M001.t%d", nr);
+    vdso_results_scope(scope, SCALING_ITERATIONS);
+
+    printf("\n  %d thread(s)%s:\n", nr, pinned ? "" : " (affinity failed)");
+    for (i = 0; i < nr; i++) {
+        printf("    hart %-4d %8.2f cycles/call %8.2f ns/call\n",
+               workers[i].cpu, workers[i].avg_cycles,
+               vdso_cycles_to_ns_hart(workers[i].avg_cycles, workers[i].cpu));
+        vdso_results_emit("avg cycles", workers[i].avg_cycles, "cycles",
+                          workers[i].cpu);
+    }
+    print_value("    Aggregate rate", rate, "calls/sec");
+
+    free(workers);
+    return rate;
+}
+
+static void run_scaling_tests(int max_threads)
+{
+    double base_rate = 0, rate = 0, efficiency = 0;
+    int cpus[CPU_SETSIZE];
+    int nr_cpus = 0, nr, i;
+    cpu_set_t allowed;
+
+    print_header("Scaling Tests (M001)");
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        perror("sched_getaffinity");
+        tests_skipped++;
+        return;
+    }
+    for (i = 0; i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &allowed))
+            cpus[nr_cpus++] = i;
+    }
+    if (max_threads <= 0 || max_threads > nr_cpus)
+        max_threads = nr_cpus;
+
+    printf("\nM001: Aggregate clock_gettime throughput, 1..%d harts\n",
+           max_threads);
+    printf("  Per-hart cycle counter calibration:\n");
+    vdso_calib_all_harts();
+    vdso_calib_print("    ");
+    printf("  %d calls per thread, one thread pinned per hart\n",
+           SCALING_ITERATIONS);
+
+    /* 1, 2, 4, ... and finally max_threads itself */
+    for (nr = 1; nr <= max_threads;
+         nr = (nr < max_threads && nr * 2 > max_threads) ? max_threads : nr * 2) {
+        rate = run_scaling_step(cpus, nr);
+        if (nr == 1)
+            base_rate = rate;
+
+        efficiency = base_rate > 0 ? rate / (base_rate * nr) * 100.0 : 0;
+        print_value("    Scaling efficiency", efficiency, "%");
+    }
+
+    /*
+     * Serialized firmware trap handling shows up as efficiency far below
+     * 100%. Shared cores, SMT and frequency limits move it too, so it is
+     * reported rather than gated.
+     */
+    printf("\n");
+    vdso_results_scope("M001", SCALING_ITERATIONS);
+    print_value("  Scaling efficiency (informational)", efficiency, "%");
 }
 
 /* ==================== Main ==================== */
@@ -631,6 +1984,10 @@ int main(int argc, char **argv)
     bool quick = false;
     bool skip_perf = false;
     bool skip_stress = false;
+    bool skip_robust = false;
+    bool scaling = false;
+    int max_threads = 0;
+    int r;
 
     /* Parse arguments */
     for (int i = 1; i < argc; i++) {
@@ -640,12 +1997,35 @@ int main(int argc, char **argv)
             skip_perf = true;
         } else if (strcmp(argv[i], "--skip-stress") == 0) {
             skip_stress = true;
+        } else if (strcmp(argv[i], "--skip-robust") == 0) {
+            skip_robust = true;
+        } else if (strcmp(argv[i], "--exec-child") == 0) {
+            return exec_child();
+        } else if (strcmp(argv[i], "--ustime") == 0) {
+            use_ustime = true;
+        } else if (strcmp(argv[i], "--storm") == 0) {
+            run_storm = true;
+        } else if (strcmp(argv[i], "--scaling") == 0) {
+            scaling = true;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            max_threads = atoi(argv[++i]);
+        } else if ((r = vdso_results_parse_arg(argc, argv, &i,
+                                               "vdso_cache_test")) != 0) {
+            if (r < 0)
+                return 2;
         } else if (strcmp(argv[i], "--help") == 0) {
             printf("Usage: %s [OPTIONS]\n", argv[0]);
             printf("Options:\n");
             printf("  --quick         Quick test (skip stress tests)\n");
             printf("  --skip-perf     Skip performance tests\n");
             printf("  --skip-stress   Skip stress tests\n");
+            printf("  --storm         Also run S004, which steps CLOCK_REALTIME (needs CAP_SYS_TIME)\n");
+            printf("  --skip-robust   Skip fork/vfork/exec/signal/clone robustness tests\n");
+            printf("  --ustime        Test the user-space timestamp source instead of the vDSO\n");
+            printf("  --scaling       Run only the multi-hart scaling tests\n");
+            printf("  --threads N     Max threads for --scaling (default: all harts)\n");
+            printf("  --json FILE     Append results as JSON lines to FILE ('-' = stdout)\n");
+            printf("  --csv FILE      Append results as CSV to FILE ('-' = stdout)\n");
             printf("  --help          Show this help\n");
             return 0;
         }
@@ -660,6 +2040,23 @@ int main(int argc, char **argv)
     printf("CPU: ");
     fflush(stdout);
     system("uname -m");
+
+    if (vdso_timing_init() < 0) {
+        fprintf(stderr, "cycle counter calibration failed\n");
+        vdso_results_close();
+        return 1;
+    }
+    vdso_timing_print("");
+    vdso_results_scope("calibration", 0);
+    vdso_results_emit("cycle counter", vdso_calib_freq_mhz(), "MHz", -1);
+    if (use_ustime) {
+        if (vdso_ustime_init(NULL, NULL, 0) < 0)
+            printf(COLOR_YELLOW "User-space timestamp source has no usable cycle counter, "
+                   "calls pass through" COLOR_RESET "\n");
+        else
+            printf("Testing the user-space timestamp source (vdso_ustime.h), "
+                   "%.3f cycles/ns\n", vdso_ustime.cycles_per_ns);
+    }
     printf("\n");
 
     /* Check if VDSO cache is enabled */
@@ -672,24 +2069,50 @@ int main(int argc, char **argv)
         printf("Note: Verify CONFIG_RISCV_VDSO_TIME_CACHE=y in kernel config\n\n");
     }
 
-    /* Run test suites */
-    run_functional_tests();
-
-    if (!skip_perf) {
-        run_performance_tests();
+    /* Run test suites; --scaling runs only the scaling section */
+    if (scaling) {
+        run_scaling_tests(max_threads);
     } else {
-        printf("\n" COLOR_YELLOW "[Performance tests skipped]" COLOR_RESET "\n");
-    }
+        run_functional_tests();
+
+        if (!skip_perf) {
+            run_performance_tests();
+        } else {
+            printf("\n" COLOR_YELLOW "[Performance tests skipped]" COLOR_RESET "\n");
+        }
 
-    run_accuracy_tests();
+        run_accuracy_tests();
 
-    if (!skip_stress && !quick) {
-        run_stress_tests();
-    } else if (quick) {
-        printf("\n" COLOR_YELLOW "[Stress tests skipped (--quick mode)]" COLOR_RESET "\n");
+        if (!skip_stress && !quick) {
+            run_stress_tests();
+        } else if (quick) {
+            printf("\n" COLOR_YELLOW "[Stress tests skipped (--quick mode)]" COLOR_RESET "\n");
+        }
+
+        if (!skip_robust)
+            run_robustness_tests();
+    }
+
+    if (use_ustime) {
+        struct vdso_ustime_stats us;
+
+        vdso_ustime_get_stats(&us);
+        printf("\nUser-space timestamp source (main thread):\n");
+        vdso_results_scope("ustime", us.calls);
+        print_value("  Calls", us.calls, "calls");
+        print_value("  Clock reads (anchors)", us.anchors, "reads");
+        print_value("  Anchors over the drift bound", us.resyncs, "reads");
+        print_value("  Max extrapolation error", us.max_error_ns, "ns");
+        print_value("  Batch window", us.window_ns, "ns");
     }
 
     print_summary();
 
+    vdso_results_scope("summary", 0);
+    vdso_results_emit("passed", tests_passed, "count", -1);
+    vdso_results_emit("failed", tests_failed, "count", -1);
+    vdso_results_emit("skipped", tests_skipped, "count", -1);
+    vdso_results_close();
+
     return tests_failed > 0 ? 1 : 0;
 }
@@ -0,0 +1,282 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Cycle-counter calibration and cycle -> nanosecond conversion
+ *
+ * scaling_cur_freq is missing on many RISC-V boards and is a single
+ * snapshot under DVFS, so conversions based on it are wrong. Instead the
+ * cycle counter is measured against CLOCK_MONOTONIC_RAW (and, on RISC-V,
+ * against the time CSR timebase) on each hart.
+ *
+ * Each hart keeps an anchor (raw ns, cycles, ticks) from its last
+ * calibration. vdso_calib_refresh() re-derives the rate over the whole
+ * interval since the anchor, which costs two counter reads rather than a
+ * new busy-wait window, so long runs can call it between phases to follow
+ * frequency changes.
+ *
+ * The cycle reader is supplied by the program so that conversions match
+ * the counter it actually samples.
+ */
+
+#ifndef VDSO_CALIB_H
+#define VDSO_CALIB_H
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#define VDSO_CALIB_MAX_HARTS    1024
+#define VDSO_CALIB_WINDOW_NS    20000000ULL     /* initial busy-wait window */
+#define VDSO_CALIB_REFRESH_NS   1000000000ULL   /* min interval for refresh */
+#define VDSO_CALIB_SAMPLES      5               /* bracket attempts per point */
+
+struct vdso_calib_hart {
+    bool valid;
+    double cycles_per_ns;       /* cycle counter rate */
+    double ticks_per_ns;        /* time CSR rate, 0 if not available */
+    uint64_t anchor_ns;         /* CLOCK_MONOTONIC_RAW at anchor */
+    uint64_t anchor_cycles;
+    uint64_t anchor_ticks;
+    unsigned int calibrations;
+};
+
+static struct {
+    uint64_t (*read_cycles)(void);
+    int default_hart;           /* first hart calibrated, used as fallback */
+    struct vdso_calib_hart harts[VDSO_CALIB_MAX_HARTS];
+} vdso_calib = { .default_hart = -1 };
+
+static inline uint64_t vdso_calib_raw_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint64_t vdso_calib_read_ticks(void)
+{
+#if defined(__riscv)
+    uint64_t t;
+
+    /* Traps to M-mode on most platforms; only used at calibration points */
+    asm volatile("rdtime %0" : "=r"(t));
+    return t;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Take one (ns, cycles, ticks) point. The counter reads are bracketed by
+ * two MONOTONIC_RAW reads and the tightest bracket out of
+ * VDSO_CALIB_SAMPLES is kept, its midpoint being the best ns estimate.
+ */
+static inline void vdso_calib_point(uint64_t *ns, uint64_t *cycles,
+                                    uint64_t *ticks)
+{
+    uint64_t best = UINT64_MAX;
+    int i;
+
+    *ns = *cycles = *ticks = 0;
+    for (i = 0; i < VDSO_CALIB_SAMPLES; i++) {
+        uint64_t t0 = vdso_calib_raw_ns();
+        uint64_t c = vdso_calib.read_cycles();
+        uint64_t k = vdso_calib_read_ticks();
+        uint64_t t1 = vdso_calib_raw_ns();
+
+        if (t1 - t0 < best) {
+            best = t1 - t0;
+            *ns = t0 + (t1 - t0) / 2;
+            *cycles = c;
+            *ticks = k;
+        }
+    }
+}
+
+static inline struct vdso_calib_hart *vdso_calib_slot(int cpu)
+{
+    if (cpu < 0 || cpu >= VDSO_CALIB_MAX_HARTS)
+        return NULL;
+    return &vdso_calib.harts[cpu];
+}
+
+/*
+ * Busy-wait calibration of the hart we are running on. Retried if the
+ * thread migrates mid-window, since cycle counters are per hart.
+ */
+static inline int vdso_calib_hart_now(void)
+{
+    struct vdso_calib_hart *h;
+    uint64_t ns0, c0, k0, ns1, c1, k1;
+    int cpu, tries;
+
+    for (tries = 0; tries < 3; tries++) {
+        cpu = sched_getcpu();
+        h = vdso_calib_slot(cpu);
+        if (!h)
+            return -1;
+
+        vdso_calib_point(&ns0, &c0, &k0);
+        do {
+            vdso_calib_point(&ns1, &c1, &k1);
+        } while (ns1 - ns0 < VDSO_CALIB_WINDOW_NS);
+
+        if (sched_getcpu() != cpu)
+            continue;
+
+        h->cycles_per_ns = (double)(c1 - c0) / (ns1 - ns0);
+        h->ticks_per_ns = (double)(k1 - k0) / (ns1 - ns0);
+        h->anchor_ns = ns1;
+        h->anchor_cycles = c1;
+        h->anchor_ticks = k1;
+        h->calibrations++;
+        h->valid = true;
+        if (vdso_calib.default_hart < 0)
+            vdso_calib.default_hart = cpu;
+        return cpu;
+    }
+
+    return -1;
+}
+
+/* Select the cycle reader and calibrate the current hart */
+static inline int vdso_calib_init(uint64_t (*read_cycles)(void))
+{
+    vdso_calib.read_cycles = read_cycles;
+    return vdso_calib_hart_now();
+}
+
+/* Calibrate every hart in our affinity mask, then restore the mask */
+static inline void vdso_calib_all_harts(void)
+{
+    cpu_set_t orig, one;
+    int cpu;
+
+    if (sched_getaffinity(0, sizeof(orig), &orig) != 0)
+        return;
+
+    for (cpu = 0; cpu < CPU_SETSIZE && cpu < VDSO_CALIB_MAX_HARTS; cpu++) {
+        if (!CPU_ISSET(cpu, &orig))
+            continue;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        if (sched_setaffinity(0, sizeof(one), &one) == 0)
+            vdso_calib_hart_now();
+    }
+
+    sched_setaffinity(0, sizeof(orig), &orig);
+}
+
+/*
+ * Re-derive the current hart's rate over the interval since its anchor
+ * once at least VDSO_CALIB_REFRESH_NS has passed. Cheap enough to call
+ * between phases of a long run. Returns true if the rate was updated.
+ */
+static inline bool vdso_calib_refresh(void)
+{
+    int cpu = sched_getcpu();
+    struct vdso_calib_hart *h = vdso_calib_slot(cpu);
+    uint64_t ns, cycles, ticks;
+
+    if (!h)
+        return false;
+    if (!h->valid)
+        return vdso_calib_hart_now() >= 0;
+
+    vdso_calib_point(&ns, &cycles, &ticks);
+    /* A point that straddles a migration mixes two harts' counters */
+    if (sched_getcpu() != cpu || ns - h->anchor_ns < VDSO_CALIB_REFRESH_NS)
+        return false;
+
+    /* A counter going backwards means the anchor was taken on another hart */
+    if (cycles <= h->anchor_cycles)
+        return vdso_calib_hart_now() >= 0;
+
+    h->cycles_per_ns = (double)(cycles - h->anchor_cycles) / (ns - h->anchor_ns);
+    h->ticks_per_ns = (double)(ticks - h->anchor_ticks) / (ns - h->anchor_ns);
+    h->anchor_ns = ns;
+    h->anchor_cycles = cycles;
+    h->anchor_ticks = ticks;
+    h->calibrations++;
+    return true;
+}
+
+/* Calibration for @cpu, falling back to the first calibrated hart */
+static inline const struct vdso_calib_hart *vdso_calib_get(int cpu)
+{
+    const struct vdso_calib_hart *h = vdso_calib_slot(cpu);
+
+    if (h && h->valid)
+        return h;
+    if (vdso_calib.default_hart >= 0)
+        return &vdso_calib.harts[vdso_calib.default_hart];
+    return NULL;
+}
+
+static inline double vdso_cycles_to_ns_hart(double cycles, int cpu)
+{
+    const struct vdso_calib_hart *h = vdso_calib_get(cpu);
+
+    return h && h->cycles_per_ns > 0 ? cycles / h->cycles_per_ns : 0.0;
+}
+
+/* Convert @cycles measured on the current hart to nanoseconds */
+static inline double vdso_cycles_to_ns(double cycles)
+{
+    return vdso_cycles_to_ns_hart(cycles, sched_getcpu());
+}
+
+/* Calls per second for a per-call cost of @cycles */
+static inline double vdso_cycles_to_rate(double cycles)
+{
+    double ns = vdso_cycles_to_ns(cycles);
+
+    return ns > 0 ? 1e9 / ns : 0.0;
+}
+
+static inline double vdso_calib_freq_mhz(void)
+{
+    const struct vdso_calib_hart *h = vdso_calib_get(sched_getcpu());
+
+    return h ? h->cycles_per_ns * 1000.0 : 0.0;
+}
+
+/* Timebase from the device tree, to cross-check the measured tick rate */
+static inline uint32_t vdso_calib_dt_timebase_hz(void)
+{
+    FILE *fp = fopen("/proc/device-tree/cpus/timebase-frequency", "rb");
+    unsigned char be[4];
+    uint32_t hz = 0;
+
+    if (!fp)
+        return 0;
+    if (fread(be, 1, sizeof(be), fp) == sizeof(be))
+        hz = (uint32_t)be[0] << 24 | be[1] << 16 | be[2] << 8 | be[3];
+    fclose(fp);
+    return hz;
+}
+
+static inline void vdso_calib_print(const char *indent)
+{
+    uint32_t dt_hz = vdso_calib_dt_timebase_hz();
+    int cpu;
+
+    for (cpu = 0; cpu < VDSO_CALIB_MAX_HARTS; cpu++) {
+        const struct vdso_calib_hart *h = &vdso_calib.harts[cpu];
+
+        if (!h->valid)
+            continue;
+        printf("%shart %-4d cycle counter %9.2f MHz", indent, cpu,
+               h->cycles_per_ns * 1000.0);
+        if (h->ticks_per_ns > 0)
+            printf(", timebase %8.3f MHz", h->ticks_per_ns * 1000.0);
+        printf("\n");
+    }
+    if (dt_hz)
+        printf("%sdevice-tree timebase-frequency: %.3f MHz\n", indent,
+               dt_hz / 1e6);
+}
+
+#endif /* VDSO_CALIB_H */
@@ -0,0 +1,606 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Call-site clock profiler, loaded with LD_PRELOAD
+ *
+ * Shows who reads the clock in a service, how often, and with what gaps,
+ * to judge whether the VDSO time cache would help it. clock_gettime(),
+ * gettimeofday() and time() are wrapped. Each call records its caller's
+ * return address and the gap since the same thread's previous call
+ * returned, i.e. the work done between two clock reads. Records go to a
+ * per-thread single-producer ring, so the wrapper takes no lock. A
+ * collector thread drains the rings into one gap histogram per call site
+ * (vdso_hist.h). A full ring drops records and counts them.
+ *
+ * Gaps are measured with vdso_timing_read() and converted with the rate
+ * vdso_calib.h measures on the loading hart at startup, over a fixed
+ * VDSO_CALIB_WINDOW_NS busy-wait, so idle time and other harts do not
+ * enter the rate. Without a user-readable counter (RISC-V without
+ * kernel.perf_user_access=2), or if calibration fails, they fall back to
+ * CLOCK_MONOTONIC_RAW, which adds one clock read per call. rdcycle is not
+ * synchronized across harts, so a gap that spans a migration and comes
+ * out negative is dropped.
+ *
+ * At exit the summary goes to stderr, or to $VDSO_CLOCKPROF_OUT. It
+ * lists the call sites by calls, with gap percentiles and the share of
+ * gaps inside the time cache window, i.e. the hit rate a per-thread cache
+ * would get there. $VDSO_CLOCKPROF_GAPS names a file that receives the
+ * process-wide gap distribution, one gap in ns per line, for
+ * vdso_cache_benchmark --replay file:PATH.
+ *
+ *   VDSO_CLOCKPROF_OUT=PATH       summary file (default stderr)
+ *   VDSO_CLOCKPROF_GAPS=PATH      gap file for --replay file:PATH
+ *   VDSO_CLOCKPROF_WINDOW_NS=N    cache window (default 1000, the
+ *                                 RISCV_VDSO_TIME_CACHE_WINDOW_NS default)
+ *   VDSO_CLOCKPROF_SAMPLE=N       record one call in N (default 1)
+ *   VDSO_CLOCKPROF_TOP=N          call sites listed (default 20)
+ *
+ * Usage: LD_PRELOAD=./build/libvdso_clockprof.so COMMAND...
+ *
+ * Processes that leave through _exit() print nothing.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "vdso_hist.h"
+#include "vdso_timing.h"
+
+#define PROF_RING_SHIFT     16          /* 1MB of records per thread */
+#define PROF_RING_SIZE      (1U << PROF_RING_SHIFT)
+#define PROF_MAX_SITES      4096
+#define PROF_POLL_NS        10000000L
+#define PROF_GAP_LINES      65536       /* lines in the replay gap file */
+#define PROF_NO_GAP         (UINT64_MAX >> 2)
+
+enum prof_fn { PROF_CLOCK_GETTIME, PROF_GETTIMEOFDAY, PROF_TIME, PROF_NR_FNS };
+
+static const char *const prof_fn_names[PROF_NR_FNS] = {
+    "clock_gettime", "gettimeofday", "time",
+};
+
+struct prof_record {
+    uintptr_t pc;
+    uint64_t gap_fn;            /* gap << 2 | fn, PROF_NO_GAP: first call */
+};
+
+enum prof_ring_state { PROF_RING_LIVE, PROF_RING_DEAD, PROF_RING_FREE };
+
+/* Written by its thread only, except tail (collector) and state */
+struct prof_ring {
+    struct prof_ring *next;
+    int state;
+    uint64_t head, tail;
+    uint64_t last_exit;         /* counter after the previous call */
+    uint64_t calls[PROF_NR_FNS], dropped;
+    unsigned int skip;
+    struct prof_record slots[PROF_RING_SIZE];
+};
+
+struct prof_site {
+    uintptr_t pc;
+    int fn;
+    uint64_t samples;
+    struct vdso_hist *hist;
+};
+
+static struct {
+    int (*clock_gettime)(clockid_t, struct timespec *);
+    int (*gettimeofday)(struct timeval *, void *);
+    time_t (*time)(time_t *);
+    bool counter;               /* cycle counter usable, else raw ns */
+    unsigned int sample;
+    bool done;
+    bool forked;                /* output files get a .PID suffix */
+    struct prof_ring *rings;    /* lock-free push, never unlinked */
+    pthread_key_t key;
+    pthread_t collector;
+    int collector_state;        /* 0 none, 1 starting, 2 running */
+    bool stop;
+    double ns_per_count;        /* startup calibration, 1.0 for raw ns */
+    uint64_t anchor_ns;
+    unsigned int threads;
+    /* collector-owned */
+    struct prof_site sites[PROF_MAX_SITES];
+    unsigned int nr_sites;
+    uint64_t lost_sites;
+    struct vdso_hist all;
+} prof;
+
+static __thread struct prof_ring *prof_tls __attribute__((tls_model("initial-exec")));
+
+static int prof_raw_clock(clockid_t clk, struct timespec *ts)
+{
+    if (prof.clock_gettime)
+        return prof.clock_gettime(clk, ts);
+    return (int)syscall(SYS_clock_gettime, clk, ts);
+}
+
+static uint64_t prof_raw_ns(void)
+{
+    struct timespec ts;
+
+    prof_raw_clock(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint64_t prof_now(void)
+{
+    return prof.counter ? vdso_timing_read() : prof_raw_ns();
+}
+
+static unsigned long prof_env(const char *name, unsigned long def)
+{
+    const char *v = getenv(name);
+
+    return v && *v ? strtoul(v, NULL, 0) : def;
+}
+
+static void prof_site_add(uintptr_t pc, int fn, uint64_t gap)
+{
+    uint64_t h = (pc ^ (uint64_t)fn) * 0x9e3779b97f4a7c15ULL;
+    unsigned int slot = (unsigned int)(h >> 52) & (PROF_MAX_SITES - 1);
+    struct prof_site *s;
+
+    for (;;) {
+        s = &prof.sites[slot];
+        if (s->hist && s->pc == pc && s->fn == fn)
+            break;
+        if (!s->hist) {
+            /* Keep a quarter free so probing stays short */
+            if (4 * (prof.nr_sites + 1) > 3 * PROF_MAX_SITES ||
+                !(s->hist = vdso_hist_alloc())) {
+                prof.lost_sites++;
+                return;
+            }
+            s->pc = pc;
+            s->fn = fn;
+            prof.nr_sites++;
+            break;
+        }
+        slot = (slot + 1) & (PROF_MAX_SITES - 1);
+    }
+
+    s->samples++;
+    if (gap != PROF_NO_GAP) {
+        vdso_hist_record(s->hist, gap);
+        vdso_hist_record(&prof.all, gap);
+    }
+}
+
+/* Only one consumer at a time: the collector, or the exit path after it */
+static void prof_drain(void)
+{
+    for (struct prof_ring *r = __atomic_load_n(&prof.rings, __ATOMIC_ACQUIRE); r;
+         r = r->next) {
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        int dead = PROF_RING_DEAD;
+
+        for (uint64_t i = r->tail; i != head; i++) {
+            const struct prof_record *rec = &r->slots[i & (PROF_RING_SIZE - 1)];
+
+            prof_site_add(rec->pc, (int)(rec->gap_fn & 3), rec->gap_fn >> 2);
+        }
+        __atomic_store_n(&r->tail, head, __ATOMIC_RELEASE);
+
+        /* Its thread is gone and every record is in: free for reuse */
+        if (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == head)
+            __atomic_compare_exchange_n(&r->state, &dead, PROF_RING_FREE, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    }
+}
+
+static void *prof_collector(void *arg)
+{
+    struct timespec poll = { 0, PROF_POLL_NS };
+
+    (void)arg;
+    while (!__atomic_load_n(&prof.stop, __ATOMIC_ACQUIRE)) {
+        prof_drain();
+        nanosleep(&poll, NULL);
+    }
+    return NULL;
+}
+
+static void prof_thread_exit(void *arg)
+{
+    struct prof_ring *r = arg;
+
+    /* Later TLS destructors that read the clock get a ring of their own */
+    prof_tls = NULL;
+    __atomic_store_n(&r->state, PROF_RING_DEAD, __ATOMIC_RELEASE);
+}
+
+/*
+ * Started at load, and again on the first call in a forked child, whose
+ * atfork handler cannot create threads. Only that restart can run in a
+ * signal handler, if the child's first clock read is made there. A failed
+ * start is retried on the next call.
+ */
+static void prof_collector_start(void)
+{
+    pthread_attr_t attr;
+    sigset_t all, old;
+    int expected = 0;
+    int ret;
+
+    if (!__atomic_compare_exchange_n(&prof.collector_state, &expected, 1, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return;
+
+    /* The collector must not take the application's signals */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 64 * 1024);
+    ret = pthread_create(&prof.collector, &attr, prof_collector, NULL);
+    pthread_attr_destroy(&attr);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    __atomic_store_n(&prof.collector_state, ret ? 0 : 2, __ATOMIC_RELEASE);
+}
+
+/*
+ * First call on a thread: reuse a drained ring or add a new one. That
+ * call may run in a signal handler, so this only uses mmap() and atomics,
+ * plus pthread_setspecific(), which does not allocate for an early key.
+ */
+static struct prof_ring *prof_ring_get(void)
+{
+    struct prof_ring *r;
+
+    for (r = __atomic_load_n(&prof.rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        int free_state = PROF_RING_FREE;
+
+        if (__atomic_compare_exchange_n(&r->state, &free_state, PROF_RING_LIVE, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            break;
+    }
+    if (!r) {
+        r = mmap(NULL, sizeof(*r), PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (r == MAP_FAILED)
+            return NULL;
+        r->next = __atomic_load_n(&prof.rings, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&prof.rings, &r->next, r, true,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            ;
+    }
+
+    r->last_exit = 0;
+    r->skip = 0;
+    __atomic_fetch_add(&prof.threads, 1, __ATOMIC_RELAXED);
+    prof_tls = r;
+    pthread_setspecific(prof.key, r);
+    return r;
+}
+
+/* Before the real call; returns the thread's ring or NULL */
+static inline struct prof_ring *prof_enter(uintptr_t pc, int fn)
+{
+    struct prof_ring *r = prof_tls;
+    uint64_t now, gap, head;
+
+    if (__builtin_expect(prof.done || !prof.clock_gettime, 0))
+        return NULL;
+    if (__builtin_expect(!__atomic_load_n(&prof.collector_state, __ATOMIC_ACQUIRE), 0))
+        prof_collector_start();
+    if (__builtin_expect(!r, 0) && !(r = prof_ring_get()))
+        return NULL;
+
+    now = prof_now();
+    gap = r->last_exit && (int64_t)(now - r->last_exit) >= 0 ?
+          now - r->last_exit : PROF_NO_GAP;
+    if (gap > PROF_NO_GAP)
+        gap = PROF_NO_GAP;
+    __atomic_store_n(&r->calls[fn], r->calls[fn] + 1, __ATOMIC_RELAXED);
+
+    if (++r->skip < prof.sample)
+        return r;
+    r->skip = 0;
+
+    head = r->head;
+    if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == PROF_RING_SIZE) {
+        __atomic_store_n(&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+        return r;
+    }
+    r->slots[head & (PROF_RING_SIZE - 1)] = (struct prof_record){ pc, gap << 2 | fn };
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+    return r;
+}
+
+static inline void prof_exit(struct prof_ring *r)
+{
+    if (r)
+        r->last_exit = prof_now();
+}
+
+int clock_gettime(clockid_t clk, struct timespec *ts)
+{
+    struct prof_ring *r = prof_enter((uintptr_t)__builtin_return_address(0),
+                                     PROF_CLOCK_GETTIME);
+    int ret = prof_raw_clock(clk, ts);
+
+    prof_exit(r);
+    return ret;
+}
+
+int gettimeofday(struct timeval *restrict tv, void *restrict tz)
+{
+    struct prof_ring *r = prof_enter((uintptr_t)__builtin_return_address(0),
+                                     PROF_GETTIMEOFDAY);
+    int ret;
+
+    if (prof.gettimeofday) {
+        ret = prof.gettimeofday(tv, tz);
+    } else {
+        struct timespec ts;
+
+        ret = prof_raw_clock(CLOCK_REALTIME, &ts);
+        tv->tv_sec = ts.tv_sec;
+        tv->tv_usec = ts.tv_nsec / 1000;
+    }
+    prof_exit(r);
+    return ret;
+}
+
+time_t time(time_t *t)
+{
+    struct prof_ring *r = prof_enter((uintptr_t)__builtin_return_address(0), PROF_TIME);
+    time_t ret;
+
+    if (prof.time) {
+        ret = prof.time(t);
+    } else {
+        struct timespec ts;
+
+        prof_raw_clock(CLOCK_REALTIME, &ts);
+        ret = ts.tv_sec;
+        if (t)
+            *t = ret;
+    }
+    prof_exit(r);
+    return ret;
+}
+
+/* The child has only the forking thread and no collector; see prof_enter() */
+static void prof_atfork_child(void)
+{
+    for (struct prof_ring *r = prof.rings; r; r = r->next) {
+        r->tail = r->head;
+        memset(r->calls, 0, sizeof(r->calls));
+        r->dropped = 0;
+        r->last_exit = 0;
+        if (r != prof_tls)
+            r->state = PROF_RING_FREE;
+    }
+    for (unsigned int i = 0; i < PROF_MAX_SITES; i++)
+        vdso_hist_free(prof.sites[i].hist);
+    memset(prof.sites, 0, sizeof(prof.sites));
+    prof.nr_sites = 0;
+    prof.lost_sites = 0;
+    vdso_hist_reset(&prof.all);
+    prof.collector_state = 0;
+    prof.forked = true;
+    prof.threads = prof_tls ? 1 : 0;
+    prof.anchor_ns = prof_raw_ns();
+}
+
+__attribute__((constructor))
+static void prof_init(void)
+{
+    prof.gettimeofday = (int (*)(struct timeval *, void *))dlsym(RTLD_NEXT, "gettimeofday");
+    prof.time = (time_t (*)(time_t *))dlsym(RTLD_NEXT, "time");
+    prof.counter = vdso_timing_counter_usable();
+    prof.ns_per_count = 1.0;
+    /* Clock reads here still go to the syscall: recording is not enabled yet */
+    if (prof.counter && vdso_calib_init(vdso_timing_read) >= 0)
+        prof.ns_per_count = 1.0 / vdso_calib_get(vdso_calib.default_hart)->cycles_per_ns;
+    else
+        prof.counter = false;
+    prof.sample = (unsigned int)prof_env("VDSO_CLOCKPROF_SAMPLE", 1);
+    if (!prof.sample)
+        prof.sample = 1;
+    vdso_hist_reset(&prof.all);
+    pthread_key_create(&prof.key, prof_thread_exit);
+    pthread_atfork(NULL, NULL, prof_atfork_child);
+    prof.anchor_ns = prof_raw_ns();
+    /* Here, so a thread's first clock read never creates one */
+    prof_collector_start();
+    /* Last: enables recording */
+    __atomic_store_n(&prof.clock_gettime,
+                     (int (*)(clockid_t, struct timespec *))dlsym(RTLD_NEXT, "clock_gettime"),
+                     __ATOMIC_RELEASE);
+}
+
+static int prof_cmp_samples(const void *a, const void *b)
+{
+    const struct prof_site *x = *(const struct prof_site *const *)a;
+    const struct prof_site *y = *(const struct prof_site *const *)b;
+
+    return (x->samples < y->samples) - (x->samples > y->samples);
+}
+
+static void prof_site_name(uintptr_t pc, char *buf, size_t len)
+{
+    Dl_info info;
+    const char *obj;
+
+    if (!dladdr((void *)pc, &info) || !info.dli_fname) {
+        snprintf(buf, len, "0x%lx", (unsigned long)pc);
+        return;
+    }
+    obj = strrchr(info.dli_fname, '/');
+    obj = obj ? obj + 1 : info.dli_fname;
+    if (info.dli_sname)
+        snprintf(buf, len, "%s+0x%lx (%s)", info.dli_sname,
+                 (unsigned long)(pc - (uintptr_t)info.dli_saddr), obj);
+    else
+        snprintf(buf, len, "0x%lx (%s)", (unsigned long)(pc - (uintptr_t)info.dli_fbase), obj);
+}
+
+/*
+ * Bucket midpoints, PROF_GAP_LINES in all, each bucket in proportion to
+ * its count; buckets under 1/PROF_GAP_LINES of the total may drop out
+ */
+static void prof_write_gaps(const char *path, double ns_per_count)
+{
+    FILE *f = fopen(path, "w");
+    uint64_t cum = 0, written = 0;
+
+    if (!f) {
+        fprintf(stderr, "vdso_clockprof: %s: %s\n", path, strerror(errno));
+        return;
+    }
+    fprintf(f, "# vdso_clockprof gaps between clock calls, ns, pid %d, %lu samples\n",
+            (int)getpid(), (unsigned long)prof.all.count);
+    for (unsigned int i = 0; i < VDSO_HIST_BUCKETS; i++) {
+        double mid = (vdso_hist_bucket_low(i) + vdso_hist_bucket_high(i)) / 2.0 * ns_per_count;
+        uint64_t upto;
+
+        cum += prof.all.buckets[i];
+        upto = (uint64_t)((double)cum * PROF_GAP_LINES / prof.all.count + 0.5);
+        for (; written < upto; written++)
+            fprintf(f, "%.1f\n", mid);
+    }
+    fclose(f);
+}
+
+/* $name, with ".PID" appended in forked children; NULL if unset */
+static const char *prof_path(const char *name, char *buf, size_t len)
+{
+    const char *v = getenv(name);
+
+    if (!v || !*v)
+        return NULL;
+    if (!prof.forked)
+        return v;
+    snprintf(buf, len, "%s.%d", v, (int)getpid());
+    return buf;
+}
+
+__attribute__((destructor))
+static void prof_report(void)
+{
+    char out_buf[4096], gaps_buf[4096];
+    const char *out_path = prof_path("VDSO_CLOCKPROF_OUT", out_buf, sizeof(out_buf));
+    const char *gaps_path = prof_path("VDSO_CLOCKPROF_GAPS", gaps_buf, sizeof(gaps_buf));
+    double window = (double)prof_env("VDSO_CLOCKPROF_WINDOW_NS", 1000);
+    unsigned int top = (unsigned int)prof_env("VDSO_CLOCKPROF_TOP", 20);
+    uint64_t calls[PROF_NR_FNS] = { 0 }, total = 0, dropped = 0;
+    struct prof_site *order[PROF_MAX_SITES];
+    double seconds, ns_per_count = prof.ns_per_count;
+    unsigned int n = 0;
+    char comm[64] = "?";
+    FILE *out = stderr;
+
+    if (!prof.clock_gettime || prof.done)
+        return;
+
+    if (__atomic_load_n(&prof.collector_state, __ATOMIC_ACQUIRE) == 2) {
+        __atomic_store_n(&prof.stop, true, __ATOMIC_RELEASE);
+        pthread_join(prof.collector, NULL);
+    }
+    prof_drain();
+    prof.done = true;
+
+    seconds = (prof_raw_ns() - prof.anchor_ns) / 1e9;
+
+    for (struct prof_ring *r = prof.rings; r; r = r->next) {
+        for (int i = 0; i < PROF_NR_FNS; i++)
+            calls[i] += r->calls[i];
+        dropped += r->dropped;
+    }
+    for (int i = 0; i < PROF_NR_FNS; i++)
+        total += calls[i];
+    if (!total)
+        return;
+
+    if (out_path && !(out = fopen(out_path, "w"))) {
+        fprintf(stderr, "vdso_clockprof: %s: %s\n", out_path, strerror(errno));
+        out = stderr;
+    }
+
+    {
+        FILE *f = fopen("/proc/self/comm", "r");
+
+        if (f) {
+            if (fgets(comm, sizeof(comm), f))
+                comm[strcspn(comm, "\n")] = '\0';
+            fclose(f);
+        }
+    }
+
+    fprintf(out, "\n=== vdso_clockprof: pid %d (%s), %.2f s, gaps by %s ===\n",
+            (int)getpid(), comm, seconds, prof.counter ? "cycle counter" : "CLOCK_MONOTONIC_RAW");
+    fprintf(out, "  Calls: %lu (%.0f/s), threads %u,", (unsigned long)total,
+            seconds > 0 ? total / seconds : 0, prof.threads);
+    for (int i = 0; i < PROF_NR_FNS; i++)
+        fprintf(out, " %s %lu", prof_fn_names[i], (unsigned long)calls[i]);
+    fprintf(out, "\n");
+    if (prof.sample > 1)
+        fprintf(out, "  Recorded one call in %u; per-site calls are scaled\n", prof.sample);
+    if (dropped || prof.lost_sites)
+        fprintf(out, "  Dropped: %lu records (ring full), %lu (site table full)\n",
+                (unsigned long)dropped, (unsigned long)prof.lost_sites);
+    if (prof.all.count)
+        fprintf(out, "  Gaps: p50 %.0f ns, p90 %.0f ns, p99 %.0f ns; %.1f%% within the %.0f ns "
+                "cache window\n",
+                vdso_hist_percentile(&prof.all, 50.0) * ns_per_count,
+                vdso_hist_percentile(&prof.all, 90.0) * ns_per_count,
+                vdso_hist_percentile(&prof.all, 99.0) * ns_per_count,
+                100.0 * vdso_hist_count_below(&prof.all,
+                                              (uint64_t)(window / ns_per_count)) / prof.all.count,
+                window);
+
+    for (unsigned int i = 0; i < PROF_MAX_SITES; i++) {
+        if (prof.sites[i].hist)
+            order[n++] = &prof.sites[i];
+    }
+    qsort(order, n, sizeof(order[0]), prof_cmp_samples);
+    if (top && n > top)
+        n = top;
+
+    fprintf(out, "\n  %-13s %12s %7s %10s %10s %10s %7s  %s\n", "Function", "Calls", "Share",
+            "p50 gap", "p90 gap", "p99 gap", "<=win", "Call site");
+    for (unsigned int i = 0; i < n; i++) {
+        const struct prof_site *s = order[i];
+        const struct vdso_hist *h = s->hist;
+        char name[256];
+
+        prof_site_name(s->pc, name, sizeof(name));
+        if (h->count)
+            fprintf(out, "  %-13s %12lu %6.2f%% %10.0f %10.0f %10.0f %6.1f%%  %s\n",
+                    prof_fn_names[s->fn], (unsigned long)(s->samples * prof.sample),
+                    100.0 * s->samples * prof.sample / total,
+                    vdso_hist_percentile(h, 50.0) * ns_per_count,
+                    vdso_hist_percentile(h, 90.0) * ns_per_count,
+                    vdso_hist_percentile(h, 99.0) * ns_per_count,
+                    100.0 * vdso_hist_count_below(h, (uint64_t)(window / ns_per_count)) /
+                    h->count, name);
+        else
+            fprintf(out, "  %-13s %12lu %6.2f%% %10s %10s %10s %7s  %s\n",
+                    prof_fn_names[s->fn], (unsigned long)(s->samples * prof.sample),
+                    100.0 * s->samples * prof.sample / total, "-", "-", "-", "-", name);
+    }
+
+    if (gaps_path && prof.all.count) {
+        prof_write_gaps(gaps_path, ns_per_count);
+        fprintf(out, "\n  Gap distribution written to %s; replay it with\n"
+                "  vdso_cache_benchmark --replay file:%s\n", gaps_path, gaps_path);
+    }
+
+    if (out != stderr)
+        fclose(out);
+}
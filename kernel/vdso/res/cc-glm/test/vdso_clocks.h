@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Clock IDs served by the generic vDSO
+ *
+ * REALTIME, MONOTONIC, BOOTTIME and TAI are computed from
+ * clock_data[CS_HRES_COARSE], MONOTONIC_RAW from clock_data[CS_RAW]; all
+ * five read the hardware counter and so go through the time cache. The
+ * coarse clocks only copy the last update and never touch the counter.
+ * Other clock IDs (CPU-time clocks, ALARM variants) take the syscall.
+ */
+
+#ifndef VDSO_CLOCKS_H
+#define VDSO_CLOCKS_H
+
+#include <stdbool.h>
+#include <time.h>
+
+struct vdso_clock_id {
+    clockid_t id;
+    const char *name;
+    bool counter;               /* reads CSR_TIME, i.e. uses the cache */
+};
+
+static const struct vdso_clock_id vdso_clock_ids[] = {
+    { CLOCK_REALTIME,           "REALTIME",             true },
+    { CLOCK_MONOTONIC,          "MONOTONIC",            true },
+    { CLOCK_MONOTONIC_RAW,      "MONOTONIC_RAW",        true },
+    { CLOCK_BOOTTIME,           "BOOTTIME",             true },
+    { CLOCK_TAI,                "TAI",                  true },
+    { CLOCK_REALTIME_COARSE,    "REALTIME_COARSE",      false },
+    { CLOCK_MONOTONIC_COARSE,   "MONOTONIC_COARSE",     false },
+};
+
+#define VDSO_NR_CLOCK_IDS (sizeof(vdso_clock_ids) / sizeof(vdso_clock_ids[0]))
+
+#endif /* VDSO_CLOCKS_H */
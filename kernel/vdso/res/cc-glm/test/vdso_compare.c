@@ -0,0 +1,385 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * A/B comparison of two VDSO test result sets
+ *
+ * Reads two JSON-lines files written with --json by vdso_cache_test,
+ * vdso_perf_benchmark or vdso_cache_benchmark (e.g. one kernel with
+ * CONFIG_RISCV_VDSO_TIME_CACHE=y and one without, or two kernel builds).
+ * A metric recorded several times (run_tests.sh --runs N) becomes a
+ * sample. For every metric present in both sets it prints the medians,
+ * the relative delta with a bootstrap 95% confidence interval, and a
+ * two-sided Mann-Whitney U p-value. Changes in the worse direction larger
+ * than the threshold are flagged as regressions only if they are also
+ * significant. With three samples per side even complete separation gives
+ * p > 0.05, so the test needs at least four per side. With fewer, a change
+ * above the threshold is reported as "untested" and not counted.
+ *
+ * Usage: vdso_compare [--threshold PCT] [--html] BASE.jsonl NEW.jsonl
+ *
+ * Exit status: 0 no regression, 1 regression(s), 2 usage or input error.
+ */
+
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BOOTSTRAP_RESAMPLES   2000
+#define DEFAULT_THRESHOLD_PCT 5.0
+#define SIGNIFICANCE          0.05
+#define MIN_TEST_SAMPLES      4     /* per side, to be able to reach SIGNIFICANCE */
+
+struct metric {
+    char name[160];
+    char unit[24];
+    double *v[2];               /* samples per side */
+    size_t n[2], cap[2];
+};
+
+static struct metric *metrics;
+static size_t nr_metrics, cap_metrics;
+
+/* Value of "key":"..." or "key":number in a JSON line, copied to @buf */
+static bool json_field(const char *line, const char *key, char *buf, size_t len)
+{
+    char pat[32];
+    const char *p, *end;
+    size_t n;
+
+    snprintf(pat, sizeof(pat), "\"%s\":", key);
+    p = strstr(line, pat);
+    if (!p)
+        return false;
+    p += strlen(pat);
+
+    if (*p == '"') {
+        for (end = ++p; *end && *end != '"'; end++) {
+            if (*end == '\\' && end[1])
+                end++;
+        }
+    } else {
+        end = p + strcspn(p, ",}");
+    }
+
+    n = (size_t)(end - p) < len - 1 ? (size_t)(end - p) : len - 1;
+    memcpy(buf, p, n);
+    buf[n] = '\0';
+    return true;
+}
+
+static struct metric *metric_get(const char *name, const char *unit)
+{
+    for (size_t i = 0; i < nr_metrics; i++) {
+        if (strcmp(metrics[i].name, name) == 0 && strcmp(metrics[i].unit, unit) == 0)
+            return &metrics[i];
+    }
+
+    if (nr_metrics == cap_metrics) {
+        size_t n = cap_metrics ? cap_metrics * 2 : 256;
+        struct metric *p = realloc(metrics, n * sizeof(*p));
+
+        if (!p)
+            return NULL;
+        metrics = p;
+        cap_metrics = n;
+    }
+
+    struct metric *m = &metrics[nr_metrics++];
+
+    memset(m, 0, sizeof(*m));
+    snprintf(m->name, sizeof(m->name), "%s", name);
+    snprintf(m->unit, sizeof(m->unit), "%s", unit);
+    return m;
+}
+
+static int metric_add(struct metric *m, int side, double v)
+{
+    if (m->n[side] == m->cap[side]) {
+        size_t n = m->cap[side] ? m->cap[side] * 2 : 8;
+        double *p = realloc(m->v[side], n * sizeof(*p));
+
+        if (!p)
+            return -1;
+        m->v[side] = p;
+        m->cap[side] = n;
+    }
+    m->v[side][m->n[side]++] = v;
+    return 0;
+}
+
+static int load(const char *path, int side)
+{
+    char line[1024], name[160], unit[24], value[64];
+    FILE *fp = fopen(path, "r");
+    size_t nr = 0;
+
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        struct metric *m;
+
+        if (!json_field(line, "name", name, sizeof(name)) ||
+            !json_field(line, "value", value, sizeof(value)) ||
+            !json_field(line, "unit", unit, sizeof(unit)))
+            continue;
+
+        /* Pass/fail and availability flags are not measurements */
+        if (strcmp(unit, "bool") == 0)
+            continue;
+
+        m = metric_get(name, unit);
+        if (!m || metric_add(m, side, strtod(value, NULL)) < 0) {
+            fclose(fp);
+            fprintf(stderr, "out of memory\n");
+            return -1;
+        }
+        nr++;
+    }
+    fclose(fp);
+
+    if (!nr) {
+        fprintf(stderr, "%s: no metric records\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double median(double *v, size_t n)
+{
+    qsort(v, n, sizeof(*v), cmp_double);
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+/* xorshift64*, fixed seed so reports are reproducible */
+static uint64_t rng_state = 0x2545f4914f6cdd1dULL;
+
+static size_t rng_below(size_t n)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (size_t)((rng_state * 2685821657736338717ULL) % n);
+}
+
+/* 95% CI of the relative change of the median, in percent */
+static void bootstrap_ci(const struct metric *m, double *lo, double *hi)
+{
+    size_t na = m->n[0], nb = m->n[1];
+    double *delta = malloc(BOOTSTRAP_RESAMPLES * sizeof(*delta));
+    double *ra = malloc(na * sizeof(*ra)), *rb = malloc(nb * sizeof(*rb));
+    size_t k = 0;
+
+    if (!delta || !ra || !rb) {
+        *lo = -INFINITY;
+        *hi = INFINITY;
+        goto out;
+    }
+
+    for (int r = 0; r < BOOTSTRAP_RESAMPLES; r++) {
+        double ma, mb;
+
+        for (size_t i = 0; i < na; i++)
+            ra[i] = m->v[0][rng_below(na)];
+        for (size_t i = 0; i < nb; i++)
+            rb[i] = m->v[1][rng_below(nb)];
+        ma = median(ra, na);
+        mb = median(rb, nb);
+        if (ma != 0)
+            delta[k++] = (mb - ma) / fabs(ma) * 100.0;
+    }
+
+    if (!k) {
+        *lo = -INFINITY;
+        *hi = INFINITY;
+        goto out;
+    }
+    qsort(delta, k, sizeof(*delta), cmp_double);
+    *lo = delta[(size_t)(0.025 * (k - 1))];
+    *hi = delta[(size_t)(0.975 * (k - 1))];
+out:
+    free(delta);
+    free(ra);
+    free(rb);
+}
+
+/* Two-sided Mann-Whitney U, normal approximation with tie correction */
+static double mann_whitney_p(const struct metric *m)
+{
+    size_t na = m->n[0], nb = m->n[1], n = na + nb, i, j;
+    struct { double v; int side; } *all = malloc(n * sizeof(*all));
+    double rank_a = 0, ties = 0, u, mu, sigma, z;
+
+    if (!all)
+        return 1.0;
+    for (i = 0; i < na; i++)
+        all[i].v = m->v[0][i], all[i].side = 0;
+    for (i = 0; i < nb; i++)
+        all[na + i].v = m->v[1][i], all[na + i].side = 1;
+    qsort(all, n, sizeof(*all), cmp_double);    /* v is the first member */
+
+    for (i = 0; i < n; i = j) {
+        double rank, t;
+
+        for (j = i; j < n && all[j].v == all[i].v; j++)
+            ;
+        rank = (i + 1 + j) / 2.0;               /* average of ranks i+1..j */
+        t = j - i;
+        ties += t * t * t - t;
+        for (size_t k = i; k < j; k++) {
+            if (all[k].side == 0)
+                rank_a += rank;
+        }
+    }
+    free(all);
+
+    u = rank_a - na * (na + 1) / 2.0;
+    mu = na * nb / 2.0;
+    sigma = sqrt(na * nb / 12.0 * ((n + 1) - ties / (n * (n - 1.0))));
+    if (sigma == 0)
+        return 1.0;
+    z = (fabs(u - mu) - 0.5) / sigma;
+    if (z < 0)
+        z = 0;
+    return erfc(z / sqrt(2.0));
+}
+
+/* +1 if larger is better, -1 if smaller is better, 0 if neither */
+static int direction(const struct metric *m)
+{
+    const char *u = m->unit, *n = m->name;
+    bool bad_count = strstr(n, "miss") || strstr(n, "invalidation") ||
+                     strstr(n, "backward") || strstr(n, "repeat") ||
+                     strstr(n, "negative") || strstr(n, "error") ||
+                     strstr(n, "stale") || strstr(n, "skew") ||
+                     strstr(n, "failed");
+
+    if (!strcmp(u, "pass") || !strcmp(u, "calls/sec") || !strcmp(u, "x"))
+        return 1;
+    if (!strcmp(u, "cycles") || !strcmp(u, "ns") || !strcmp(u, "s") ||
+        !strcmp(u, "traps") || !strcmp(u, "instructions") ||
+        !strcmp(u, "reads") || !strcmp(u, "ratio"))
+        return -1;
+    if (!strcmp(u, "%") || !strcmp(u, "1/s") || !strcmp(u, "count"))
+        return bad_count ? -1 : (strcmp(u, "count") ? 1 : 0);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    double threshold = DEFAULT_THRESHOLD_PCT;
+    bool html = false;
+    const char *files[2] = { NULL, NULL };
+    int nr_files = 0, regressions = 0, compared = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--html") == 0) {
+            html = true;
+        } else if (argv[i][0] != '-' && nr_files < 2) {
+            files[nr_files++] = argv[i];
+        } else {
+            nr_files = -1;
+            break;
+        }
+    }
+    if (nr_files != 2) {
+        fprintf(stderr, "Usage: %s [--threshold PCT] [--html] BASE.jsonl NEW.jsonl\n",
+                argv[0]);
+        return 2;
+    }
+
+    if (load(files[0], 0) < 0 || load(files[1], 1) < 0)
+        return 2;
+
+    if (html) {
+        printf("<p>Base: %s<br>New: %s<br>Regression threshold: %.1f%%</p>\n",
+               files[0], files[1], threshold);
+        printf("<table>\n<tr><th>Metric</th><th>Unit</th><th>n</th><th>Base</th>"
+               "<th>New</th><th>Delta</th><th>95%% CI</th><th>p</th><th>Verdict</th></tr>\n");
+    } else {
+        printf("Base: %s\nNew:  %s\nRegression threshold: %.1f%%\n\n",
+               files[0], files[1], threshold);
+        printf("%-48s %-10s %7s %12s %12s %8s %19s %7s  %s\n", "Metric", "Unit", "n",
+               "Base", "New", "Delta", "95% CI", "p", "Verdict");
+    }
+
+    for (size_t i = 0; i < nr_metrics; i++) {
+        struct metric *m = &metrics[i];
+        double ma, mb, delta, lo = NAN, hi = NAN, p = NAN, worse;
+        bool stats, significant = false;
+        const char *verdict;
+        char n[16], ci[32], pv[16];
+        int dir;
+
+        if (!m->n[0] || !m->n[1])
+            continue;
+        compared++;
+
+        stats = m->n[0] >= MIN_TEST_SAMPLES && m->n[1] >= MIN_TEST_SAMPLES;
+        if (stats) {
+            bootstrap_ci(m, &lo, &hi);
+            p = mann_whitney_p(m);
+            significant = p < SIGNIFICANCE && (lo > 0 || hi < 0);
+        }
+
+        ma = median(m->v[0], m->n[0]);
+        mb = median(m->v[1], m->n[1]);
+        delta = ma != 0 ? (mb - ma) / fabs(ma) * 100.0 : (mb != 0 ? INFINITY : 0);
+
+        dir = direction(m);
+        worse = -dir * delta;
+        if (dir == 0 || fabs(delta) <= threshold)
+            verdict = "~";
+        else if (!stats)
+            verdict = "untested";   /* too few samples to reach significance */
+        else if (!significant)
+            verdict = "noise";
+        else if (worse > 0)
+            verdict = "REGRESSION";
+        else
+            verdict = "improved";
+        if (!strcmp(verdict, "REGRESSION"))
+            regressions++;
+
+        snprintf(n, sizeof(n), "%zu/%zu", m->n[0], m->n[1]);
+        if (stats && isfinite(lo) && isfinite(hi)) {
+            snprintf(ci, sizeof(ci), "[%+.1f%%, %+.1f%%]", lo, hi);
+            snprintf(pv, sizeof(pv), "%.3f", p);
+        } else {
+            snprintf(ci, sizeof(ci), "-");
+            snprintf(pv, sizeof(pv), stats ? "%.3f" : "-", p);
+        }
+
+        if (html)
+            printf("<tr class=\"%s\"><td>%s</td><td>%s</td><td>%s</td><td>%.4g</td>"
+                   "<td>%.4g</td><td>%+.1f%%</td><td>%s</td><td>%s</td><td>%s</td></tr>\n",
+                   !strcmp(verdict, "REGRESSION") ? "fail" :
+                   !strcmp(verdict, "improved") ? "pass" : "",
+                   m->name, m->unit, n, ma, mb, delta, ci, pv, verdict);
+        else
+            printf("%-48s %-10s %7s %12.4g %12.4g %+7.1f%% %19s %7s  %s\n",
+                   m->name, m->unit, n, ma, mb, delta, ci, pv, verdict);
+    }
+
+    if (html)
+        printf("</table>\n<p>%d metrics compared, %d regression(s)</p>\n",
+               compared, regressions);
+    else
+        printf("\n%d metrics compared, %d regression(s)\n", compared, regressions);
+
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,246 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Fixed-memory log-linear latency histogram (HDR-style)
+ *
+ * Values below VDSO_HIST_SUB_COUNT are counted exactly. Every power-of-two
+ * range above that is split into VDSO_HIST_SUB_COUNT linear sub-buckets, so
+ * the relative error of any recorded value is bounded by 1/VDSO_HIST_SUB_COUNT
+ * (~3%) over the whole 64-bit range, with a fixed 15KB footprint.
+ *
+ * A histogram is owned by exactly one thread while recording, so recording
+ * needs no locks or atomics. Per-thread histograms are combined with
+ * vdso_hist_merge() once the threads have been joined.
+ *
+ * Header-only so that vdso_cache_test.c and vdso_cache_benchmark.c stay
+ * single-file builds.
+ */
+
+#ifndef VDSO_HIST_H
+#define VDSO_HIST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VDSO_HIST_SUB_BITS    5
+#define VDSO_HIST_SUB_COUNT   (1U << VDSO_HIST_SUB_BITS)
+#define VDSO_HIST_BUCKETS     ((64 - VDSO_HIST_SUB_BITS + 1) * VDSO_HIST_SUB_COUNT)
+
+struct vdso_hist {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[VDSO_HIST_BUCKETS];
+};
+
+/* Percentiles reported by vdso_hist_print_percentiles() */
+static const double vdso_hist_percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+#define VDSO_HIST_NR_PERCENTILES \
+    (sizeof(vdso_hist_percentiles) / sizeof(vdso_hist_percentiles[0]))
+
+static inline void vdso_hist_reset(struct vdso_hist *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+static inline struct vdso_hist *vdso_hist_alloc(void)
+{
+    struct vdso_hist *h = malloc(sizeof(*h));
+
+    if (h)
+        vdso_hist_reset(h);
+    return h;
+}
+
+static inline void vdso_hist_free(struct vdso_hist *h)
+{
+    free(h);
+}
+
+static inline unsigned int vdso_hist_index(uint64_t v)
+{
+    unsigned int msb, shift;
+
+    if (v < VDSO_HIST_SUB_COUNT)
+        return (unsigned int)v;
+
+    msb = 63 - __builtin_clzll(v);
+    shift = msb - VDSO_HIST_SUB_BITS;
+
+    return (shift + 1) * VDSO_HIST_SUB_COUNT +
+           (unsigned int)((v >> shift) & (VDSO_HIST_SUB_COUNT - 1));
+}
+
+/* Smallest value that maps to bucket @idx */
+static inline uint64_t vdso_hist_bucket_low(unsigned int idx)
+{
+    unsigned int shift;
+
+    if (idx < VDSO_HIST_SUB_COUNT)
+        return idx;
+
+    shift = idx / VDSO_HIST_SUB_COUNT - 1;
+    return (uint64_t)(VDSO_HIST_SUB_COUNT + idx % VDSO_HIST_SUB_COUNT) << shift;
+}
+
+/* Largest value that maps to bucket @idx */
+static inline uint64_t vdso_hist_bucket_high(unsigned int idx)
+{
+    unsigned int shift;
+
+    if (idx < VDSO_HIST_SUB_COUNT)
+        return idx;
+
+    shift = idx / VDSO_HIST_SUB_COUNT - 1;
+    return vdso_hist_bucket_low(idx) + ((1ULL << shift) - 1);
+}
+
+static inline void vdso_hist_record(struct vdso_hist *h, uint64_t v)
+{
+    h->buckets[vdso_hist_index(v)]++;
+    h->count++;
+    h->sum += v;
+    if (v < h->min)
+        h->min = v;
+    if (v > h->max)
+        h->max = v;
+}
+
+/* Fold @src into @dst; call after the thread owning @src has finished */
+static inline void vdso_hist_merge(struct vdso_hist *dst,
+                                   const struct vdso_hist *src)
+{
+    unsigned int i;
+
+    if (!src->count)
+        return;
+
+    for (i = 0; i < VDSO_HIST_BUCKETS; i++)
+        dst->buckets[i] += src->buckets[i];
+
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min)
+        dst->min = src->min;
+    if (src->max > dst->max)
+        dst->max = src->max;
+}
+
+static inline double vdso_hist_mean(const struct vdso_hist *h)
+{
+    return h->count ? (double)h->sum / h->count : 0.0;
+}
+
+/*
+ * Value at percentile @p (0-100]. Returns the upper bound of the bucket
+ * holding the rank, clamped to the recorded min/max, so the result is
+ * never optimistic by more than one bucket width.
+ */
+static inline uint64_t vdso_hist_percentile(const struct vdso_hist *h, double p)
+{
+    uint64_t rank, seen = 0;
+    unsigned int i;
+
+    if (!h->count)
+        return 0;
+
+    rank = (uint64_t)(p / 100.0 * h->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > h->count)
+        rank = h->count;
+
+    for (i = 0; i < VDSO_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint64_t v = vdso_hist_bucket_high(i);
+
+            if (v > h->max)
+                v = h->max;
+            if (v < h->min)
+                v = h->min;
+            return v;
+        }
+    }
+
+    return h->max;
+}
+
+/* Number of recorded values strictly below @limit (bucket resolution) */
+static inline uint64_t vdso_hist_count_below(const struct vdso_hist *h,
+                                             uint64_t limit)
+{
+    uint64_t n = 0;
+    unsigned int i;
+
+    for (i = 0; i < VDSO_HIST_BUCKETS; i++) {
+        if (vdso_hist_bucket_high(i) >= limit)
+            break;
+        n += h->buckets[i];
+    }
+
+    return n;
+}
+
+/* @ns_per_unit > 0 adds a nanosecond column (see vdso_calib.h) */
+static inline void vdso_hist_print_percentiles(const struct vdso_hist *h,
+                                               const char *indent,
+                                               const char *unit,
+                                               double ns_per_unit)
+{
+    unsigned int i;
+
+    for (i = 0; i < VDSO_HIST_NR_PERCENTILES; i++) {
+        uint64_t v = vdso_hist_percentile(h, vdso_hist_percentiles[i]);
+
+        printf("%sp%-6g %10lu %s", indent, vdso_hist_percentiles[i],
+               (unsigned long)v, unit);
+        if (ns_per_unit > 0)
+            printf(" %12.1f ns", v * ns_per_unit);
+        printf("\n");
+    }
+}
+
+/*
+ * Dump every non-empty bucket with a bar scaled to the fullest bucket.
+ * A cached vDSO read and a CSR_TIME trap show up as two separate peaks.
+ */
+static inline void vdso_hist_print_buckets(const struct vdso_hist *h,
+                                           const char *indent)
+{
+    uint64_t peak = 0, cum = 0;
+    unsigned int i;
+
+    if (!h->count)
+        return;
+
+    for (i = 0; i < VDSO_HIST_BUCKETS; i++) {
+        if (h->buckets[i] > peak)
+            peak = h->buckets[i];
+    }
+
+    printf("%s%21s %12s %8s\n", indent, "range", "count", "cum%");
+    for (i = 0; i < VDSO_HIST_BUCKETS; i++) {
+        char bar[41];
+        int len;
+
+        if (!h->buckets[i])
+            continue;
+
+        cum += h->buckets[i];
+        len = (int)((h->buckets[i] * 40 + peak - 1) / peak);
+        memset(bar, '#', len);
+        bar[len] = '\0';
+
+        printf("%s[%9lu, %9lu] %12lu %7.3f%% %s\n", indent,
+               (unsigned long)vdso_hist_bucket_low(i),
+               (unsigned long)vdso_hist_bucket_high(i),
+               (unsigned long)h->buckets[i],
+               (double)cum / h->count * 100.0, bar);
+    }
+}
+
+#endif /* VDSO_HIST_H */
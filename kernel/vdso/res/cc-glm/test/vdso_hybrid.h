@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * User-space shim for the trap-free hybrid vDSO clock
+ *
+ * vdso_clock_gettime_hybrid() calls __vdso_clock_gettime_hybrid() (added by
+ * riscv-vdso-cache-patch-fix/0007) when the running kernel's vDSO exports
+ * it, and otherwise falls back to clock_gettime().
+ *
+ * The vDSO entry interpolates from a per-hart anchor and needs the
+ * caller's hart, which it cannot read without a syscall. The shim passes
+ * the thread's rseq area (registered by glibc >= 2.35); the vDSO reads
+ * cpu_id from it before and after the rdcycle and falls back to the
+ * normal path itself if the thread migrated in between. Without rseq the
+ * shim passes NULL, which also takes the normal path.
+ */
+
+#ifndef VDSO_HYBRID_H
+#define VDSO_HYBRID_H
+
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+/* Exported by glibc >= 2.35, absent (NULL) with older libcs */
+extern const ptrdiff_t __rseq_offset __attribute__((weak));
+extern const unsigned int __rseq_size __attribute__((weak));
+
+typedef int (*vdso_hybrid_fn)(clockid_t clock, struct timespec *ts,
+                              const void *rseq);
+
+static struct {
+    bool probed;
+    vdso_hybrid_fn fn;
+} vdso_hybrid;
+
+/* Resolve __vdso_clock_gettime_hybrid once; NULL if the vDSO lacks it */
+static inline vdso_hybrid_fn vdso_hybrid_lookup(void)
+{
+    void *h;
+
+    if (vdso_hybrid.probed)
+        return vdso_hybrid.fn;
+    vdso_hybrid.probed = true;
+
+    if (sizeof(struct timespec) != 16)
+        return NULL;
+
+    h = dlopen("linux-vdso.so.1", RTLD_NOW | RTLD_NOLOAD);
+    if (!h)
+        return NULL;
+    vdso_hybrid.fn = (vdso_hybrid_fn)dlsym(h, "__vdso_clock_gettime_hybrid");
+    return vdso_hybrid.fn;
+}
+
+static inline bool vdso_hybrid_available(void)
+{
+    return vdso_hybrid_lookup() != NULL;
+}
+
+/* The calling thread's rseq area, or NULL if libc did not register one */
+static inline const void *vdso_hybrid_rseq(void)
+{
+    if (!&__rseq_offset || !&__rseq_size || __rseq_size == 0)
+        return NULL;
+    return (const char *)__builtin_thread_pointer() + __rseq_offset;
+}
+
+/* clock_gettime() without a CSR_TIME trap when the kernel supports it */
+static inline int vdso_clock_gettime_hybrid(clockid_t clock, struct timespec *ts)
+{
+    vdso_hybrid_fn fn = vdso_hybrid_lookup();
+
+    /* On error, let clock_gettime() report it through errno */
+    if (fn && fn(clock, ts, vdso_hybrid_rseq()) == 0)
+        return 0;
+    return clock_gettime(clock, ts);
+}
+
+#endif /* VDSO_HYBRID_H */
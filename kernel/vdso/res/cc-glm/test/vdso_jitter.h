@@ -0,0 +1,298 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Jitter and interference measurement for the time path (hwlat-style)
+ *
+ * One thread, pinned to a hart, calls clock_gettime() back to back and
+ * measures the time between consecutive returns. Any gap above a
+ * threshold is recorded with its offset into the run and with what else
+ * happened on the hart around it:
+ *
+ *   irqs, timer     interrupts on the hart, from /proc/interrupts (timer:
+ *                   lines whose name contains "timer", e.g. riscv-timer)
+ *   csw             voluntary + involuntary context switches of the thread
+ *                   (getrusage(RUSAGE_THREAD))
+ *   traps           M-mode emulations (SBI ILLEGAL_INSN perf counter, if
+ *                   the caller passes its fd; see vdso_perf.h)
+ *   inval           time cache invalidations on a clock_data seq bump
+ *                   (CONFIG_RISCV_VDSO_TIME_CACHE_STATS, vdso_cache_stats.h)
+ *
+ * Reading these sources takes syscalls, so it is never done inside the
+ * timed part of the loop. They are snapshotted after every gap and at
+ * least every @window_ns of spinning, and the loop restarts its clock
+ * afterwards. The deltas attached to a gap therefore cover at most one
+ * window plus the gap, which is shorter than a tick at HZ <= 1000.
+ *
+ * Needs vdso_calib_init() to have selected the cycle reader.
+ */
+
+#ifndef VDSO_JITTER_H
+#define VDSO_JITTER_H
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "vdso_calib.h"
+#include "vdso_cache_stats.h"
+#include "vdso_hist.h"
+
+#define VDSO_JITTER_MAX_GAPS    4096        /* gaps kept for the timeline */
+#define VDSO_JITTER_WINDOW_NS   1000000ULL  /* max snapshot interval */
+
+/* Most specific first: the first source with a non-zero delta is the cause */
+enum vdso_jitter_cause {
+    VDSO_JITTER_TIMER,
+    VDSO_JITTER_IRQ,
+    VDSO_JITTER_CSW,
+    VDSO_JITTER_INVAL,
+    VDSO_JITTER_TRAP,
+    VDSO_JITTER_UNKNOWN,
+    VDSO_JITTER_NR_CAUSES,
+};
+
+static const char *const vdso_jitter_causes[VDSO_JITTER_NR_CAUSES] = {
+    "timer", "irq", "csw", "inval", "trap", "unknown",
+};
+
+struct vdso_jitter_counts {
+    uint64_t irqs;              /* all interrupts on the hart, incl. timer */
+    uint64_t timer;
+    uint64_t csw;
+    uint64_t traps;
+    uint64_t inval;
+};
+
+struct vdso_jitter_gap {
+    double t_ns;                /* offset of the gap's end into the run */
+    double gap_ns;
+    struct vdso_jitter_counts d;
+    enum vdso_jitter_cause cause;
+};
+
+struct vdso_jitter_config {
+    int cpu;                    /* hart to pin to */
+    double threshold_ns;
+    double duration_ns;
+    double window_ns;           /* 0: VDSO_JITTER_WINDOW_NS */
+    int (*gettime)(clockid_t, struct timespec *);
+    int trap_fd;                /* perf counter fd for traps, -1 if none */
+    struct vdso_hist *hist;     /* optional, every call's gap in cycles */
+};
+
+struct vdso_jitter_result {
+    uint64_t calls;
+    uint64_t nr_gaps;           /* may exceed nr_stored */
+    size_t nr_stored;
+    struct vdso_jitter_gap gaps[VDSO_JITTER_MAX_GAPS];
+    uint64_t by_cause[VDSO_JITTER_NR_CAUSES];
+    double max_gap_ns;
+    double seconds;
+    bool has_irqs, has_traps, has_inval;
+};
+
+/* First hart of /sys/devices/system/cpu/isolated, -1 if none */
+static inline int vdso_jitter_isolated_cpu(void)
+{
+    FILE *f = fopen("/sys/devices/system/cpu/isolated", "r");
+    int cpu = -1;
+
+    if (!f)
+        return -1;
+    if (fscanf(f, "%d", &cpu) != 1)
+        cpu = -1;
+    fclose(f);
+    return cpu;
+}
+
+static inline int vdso_jitter_pin(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+}
+
+/*
+ * Sum @cpu's column of /proc/interrupts. The header names the columns
+ * ("CPU0 CPU2 ..."), which skip offline harts, so the column is looked
+ * up rather than assumed.
+ */
+static inline bool vdso_jitter_read_irqs(int cpu, uint64_t *irqs, uint64_t *timer)
+{
+    FILE *f = fopen("/proc/interrupts", "r");
+    char line[4096];
+    int col = -1;
+
+    *irqs = *timer = 0;
+    if (!f)
+        return false;
+
+    if (fgets(line, sizeof(line), f)) {
+        char *tok, *save;
+        int n = 0;
+
+        for (tok = strtok_r(line, " \t\n", &save); tok;
+             tok = strtok_r(NULL, " \t\n", &save), n++) {
+            if (strncmp(tok, "CPU", 3) == 0 && atoi(tok + 3) == cpu) {
+                col = n;
+                break;
+            }
+        }
+    }
+    if (col < 0) {
+        fclose(f);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        char *p = strchr(line, ':');
+        unsigned long long v = 0;
+
+        if (!p)
+            continue;
+        p++;
+        for (int n = 0; n <= col; n++) {
+            char *end;
+
+            v = strtoull(p, &end, 10);
+            if (end == p) {     /* fewer columns, e.g. "ERR:" */
+                v = 0;
+                break;
+            }
+            p = end;
+        }
+        *irqs += v;
+        if (strstr(p, "timer"))
+            *timer += v;
+    }
+
+    fclose(f);
+    return true;
+}
+
+static inline void vdso_jitter_snapshot(const struct vdso_jitter_config *cfg,
+                                        struct vdso_jitter_result *res,
+                                        struct vdso_jitter_counts *c)
+{
+    struct vdso_cache_stats cs;
+    struct rusage ru;
+    uint64_t v;
+
+    memset(c, 0, sizeof(*c));
+    res->has_irqs = vdso_jitter_read_irqs(cfg->cpu, &c->irqs, &c->timer);
+    if (getrusage(RUSAGE_THREAD, &ru) == 0)
+        c->csw = ru.ru_nvcsw + ru.ru_nivcsw;
+    res->has_traps = cfg->trap_fd >= 0 &&
+                     read(cfg->trap_fd, &v, sizeof(v)) == (ssize_t)sizeof(v);
+    if (res->has_traps)
+        c->traps = v;
+    res->has_inval = vdso_cache_stats_read(&cs);
+    if (res->has_inval)
+        c->inval = cs.invalidations;
+}
+
+static inline enum vdso_jitter_cause
+vdso_jitter_classify(const struct vdso_jitter_counts *d)
+{
+    if (d->timer)
+        return VDSO_JITTER_TIMER;
+    if (d->irqs)
+        return VDSO_JITTER_IRQ;
+    if (d->csw)
+        return VDSO_JITTER_CSW;
+    if (d->inval)
+        return VDSO_JITTER_INVAL;
+    if (d->traps)
+        return VDSO_JITTER_TRAP;
+    return VDSO_JITTER_UNKNOWN;
+}
+
+/*
+ * Pin to cfg->cpu and spin for cfg->duration_ns. Returns 0, or -1 if the
+ * hart cannot be used (the affinity of the calling thread is then left
+ * as it was).
+ */
+static inline int vdso_jitter_run(const struct vdso_jitter_config *cfg,
+                                  struct vdso_jitter_result *res)
+{
+    uint64_t (*rd)(void) = vdso_calib.read_cycles;
+    const struct vdso_calib_hart *h;
+    struct vdso_jitter_counts base, cur;
+    uint64_t threshold, window, duration, start, prev, snap, now;
+    struct timespec ts;
+    cpu_set_t old;
+
+    memset(res, 0, sizeof(*res));
+    if (sched_getaffinity(0, sizeof(old), &old) < 0 || vdso_jitter_pin(cfg->cpu) < 0)
+        return -1;
+
+    /* Cycle counters are per hart: calibrate the one we now run on */
+    h = vdso_calib_get(cfg->cpu);
+    if ((!h || !h->valid || h->cycles_per_ns <= 0) && vdso_calib_hart_now() == cfg->cpu)
+        h = vdso_calib_get(cfg->cpu);
+    if (!h || !h->valid || h->cycles_per_ns <= 0) {
+        sched_setaffinity(0, sizeof(old), &old);
+        return -1;
+    }
+
+    threshold = (uint64_t)(cfg->threshold_ns * h->cycles_per_ns);
+    window = (uint64_t)((cfg->window_ns > 0 ? cfg->window_ns : VDSO_JITTER_WINDOW_NS) *
+                        h->cycles_per_ns);
+    duration = (uint64_t)(cfg->duration_ns * h->cycles_per_ns);
+
+    vdso_jitter_snapshot(cfg, res, &base);
+    start = prev = snap = rd();
+    for (;;) {
+        cfg->gettime(CLOCK_MONOTONIC, &ts);
+        now = rd();
+        res->calls++;
+        if (cfg->hist)
+            vdso_hist_record(cfg->hist, now - prev);
+
+        if (now - prev > threshold) {
+            struct vdso_jitter_gap g = {
+                .t_ns = (now - start) / h->cycles_per_ns,
+                .gap_ns = (now - prev) / h->cycles_per_ns,
+            };
+
+            vdso_jitter_snapshot(cfg, res, &cur);
+            g.d.irqs = cur.irqs - base.irqs;
+            g.d.timer = cur.timer - base.timer;
+            g.d.csw = cur.csw - base.csw;
+            g.d.traps = cur.traps - base.traps;
+            g.d.inval = cur.inval - base.inval;
+            g.cause = vdso_jitter_classify(&g.d);
+            base = cur;
+
+            res->nr_gaps++;
+            res->by_cause[g.cause]++;
+            if (g.gap_ns > res->max_gap_ns)
+                res->max_gap_ns = g.gap_ns;
+            if (res->nr_stored < VDSO_JITTER_MAX_GAPS)
+                res->gaps[res->nr_stored++] = g;
+        } else if (now - snap > window) {
+            vdso_jitter_snapshot(cfg, res, &base);
+        } else {
+            prev = now;
+            continue;
+        }
+
+        /* Bookkeeping is not part of any gap */
+        if (now - start > duration)
+            break;
+        prev = snap = rd();
+    }
+
+    res->seconds = (now - start) / h->cycles_per_ns / 1e9;
+    sched_setaffinity(0, sizeof(old), &old);
+    return 0;
+}
+
+#endif /* VDSO_JITTER_H */
@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * User-space shim for the batched multi-clock vDSO read
+ *
+ * vdso_clock_gettime_multi() calls __vdso_clock_gettime_multi() (added by
+ * riscv-vdso-cache-patch-fix/0003) when the running kernel's vDSO exports
+ * it, and otherwise falls back to one clock_gettime() per clock, so
+ * callers can use it unconditionally.
+ *
+ * The vDSO symbol takes struct __kernel_timespec, which has the same
+ * layout as struct timespec on 64-bit targets; the shim only binds to it
+ * there. Like clock_gettime(), the shim returns -1 and sets errno on
+ * failure: EFAULT for a NULL array, otherwise the error the vDSO's
+ * syscall fallback returned (EINVAL for an unknown clock).
+ */
+
+#ifndef VDSO_MULTI_H
+#define VDSO_MULTI_H
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define VDSO_MULTI_MAX  8   /* VDSO_CLOCK_MULTI_MAX in the kernel patch */
+
+typedef int (*vdso_multi_fn)(const clockid_t *clocks, struct timespec *ts,
+                             unsigned int n);
+
+static struct {
+    bool probed;
+    vdso_multi_fn fn;
+} vdso_multi;
+
+/* Resolve __vdso_clock_gettime_multi once; NULL if the vDSO lacks it */
+static inline vdso_multi_fn vdso_multi_lookup(void)
+{
+    void *h;
+
+    if (vdso_multi.probed)
+        return vdso_multi.fn;
+    vdso_multi.probed = true;
+
+    if (sizeof(struct timespec) != 16)
+        return NULL;
+
+    h = dlopen("linux-vdso.so.1", RTLD_NOW | RTLD_NOLOAD);
+    if (!h)
+        return NULL;
+    vdso_multi.fn = (vdso_multi_fn)dlsym(h, "__vdso_clock_gettime_multi");
+    return vdso_multi.fn;
+}
+
+static inline bool vdso_multi_available(void)
+{
+    return vdso_multi_lookup() != NULL;
+}
+
+/* One clock_gettime() per clock: what callers do without the batch API */
+static inline int vdso_clock_gettime_each(const clockid_t *clocks,
+                                          struct timespec *ts, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        if (clock_gettime(clocks[i], &ts[i]) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Fill ts[i] for clocks[i], sharing one counter read when possible */
+static inline int vdso_clock_gettime_multi(const clockid_t *clocks,
+                                           struct timespec *ts, unsigned int n)
+{
+    vdso_multi_fn fn = vdso_multi_lookup();
+    int ret;
+
+    if (n && (!clocks || !ts)) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (!fn)
+        return vdso_clock_gettime_each(clocks, ts, n);
+
+    /* The vDSO returns 0 or the syscall fallback's -errno */
+    ret = fn(clocks, ts, n);
+    if (ret == 0)
+        return 0;
+    errno = ret < 0 ? -ret : EINVAL;
+    return -1;
+}
+
+#endif /* VDSO_MULTI_H */
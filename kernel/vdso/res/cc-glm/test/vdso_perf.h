@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * perf_event_open() collector for trap counts per test phase
+ *
+ * Latency only hints at whether CSR_TIME still traps. This counts, for
+ * the calling thread:
+ *
+ *   cycles, instructions   generic hardware events, user mode only
+ *   traps                  SBI firmware event ILLEGAL_INSN (RISC-V only):
+ *                          the M-mode emulations of rdtime/CSR_TIME on
+ *                          harts without a readable time CSR
+ *
+ * Firmware events are exposed by the RISC-V SBI PMU driver as raw events
+ * with config bits [63:62] = 0b10; sampling and mode filtering need
+ * Sscofpmf, plain counting does not. Firmware counters are not filtered
+ * by privilege, so phases that sleep also count the kernel's own reads.
+ *
+ * Every counter is optional: vdso_perf_open() keeps whatever opened and
+ * the report prints "n/a" for the rest, e.g. on other architectures, in
+ * VMs or with kernel.perf_event_paranoid too high.
+ */
+
+#ifndef VDSO_PERF_H
+#define VDSO_PERF_H
+
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "vdso_results.h"
+
+/* SBI PMU firmware event: raw config type 0b10, SBI_PMU_FW_ILLEGAL_INSN */
+#define VDSO_PERF_SBI_FW(code)     ((2ULL << 62) | (code))
+#define VDSO_PERF_SBI_ILLEGAL_INSN 4
+
+enum vdso_perf_counter {
+    VDSO_PERF_CYCLES,
+    VDSO_PERF_INSTRUCTIONS,
+    VDSO_PERF_TRAPS,
+    VDSO_PERF_NR,
+};
+
+static const char *const vdso_perf_names[VDSO_PERF_NR] = {
+    "cycles", "instructions", "traps",
+};
+
+struct vdso_perf {
+    int fd[VDSO_PERF_NR];               /* -1 if not available */
+    uint64_t start[VDSO_PERF_NR];
+};
+
+struct vdso_perf_counts {
+    bool valid[VDSO_PERF_NR];
+    uint64_t value[VDSO_PERF_NR];
+};
+
+static inline int vdso_perf_open_one(uint32_t type, uint64_t config,
+                                     bool user_only)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = user_only;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* Open the counters for the calling thread; false if none are available */
+static inline bool vdso_perf_open(struct vdso_perf *p)
+{
+    bool any = false;
+
+    p->fd[VDSO_PERF_CYCLES] =
+        vdso_perf_open_one(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true);
+    p->fd[VDSO_PERF_INSTRUCTIONS] =
+        vdso_perf_open_one(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, true);
+#if defined(__riscv)
+    p->fd[VDSO_PERF_TRAPS] =
+        vdso_perf_open_one(PERF_TYPE_RAW,
+                           VDSO_PERF_SBI_FW(VDSO_PERF_SBI_ILLEGAL_INSN), false);
+#else
+    p->fd[VDSO_PERF_TRAPS] = -1;
+#endif
+
+    for (int i = 0; i < VDSO_PERF_NR; i++) {
+        p->start[i] = 0;
+        any |= p->fd[i] >= 0;
+    }
+    return any;
+}
+
+static inline void vdso_perf_close(struct vdso_perf *p)
+{
+    for (int i = 0; i < VDSO_PERF_NR; i++) {
+        if (p->fd[i] >= 0)
+            close(p->fd[i]);
+        p->fd[i] = -1;
+    }
+}
+
+static inline bool vdso_perf_read(int fd, uint64_t *v)
+{
+    return fd >= 0 && read(fd, v, sizeof(*v)) == (ssize_t)sizeof(*v);
+}
+
+/* Mark the start of a phase; counters keep running between phases */
+static inline void vdso_perf_begin(struct vdso_perf *p)
+{
+    for (int i = 0; i < VDSO_PERF_NR; i++) {
+        if (!vdso_perf_read(p->fd[i], &p->start[i]))
+            p->start[i] = 0;
+    }
+}
+
+/* Counts since the last vdso_perf_begin() */
+static inline void vdso_perf_end(struct vdso_perf *p, struct vdso_perf_counts *c)
+{
+    for (int i = 0; i < VDSO_PERF_NR; i++) {
+        uint64_t v;
+
+        c->valid[i] = vdso_perf_read(p->fd[i], &v);
+        c->value[i] = c->valid[i] ? v - p->start[i] : 0;
+    }
+}
+
+/*
+ * Print and emit the counts divided by @calls clock_gettime() calls. The
+ * metrics go to the current vdso_results scope as "<counter> per call".
+ */
+static inline void vdso_perf_report(const struct vdso_perf_counts *c,
+                                    uint64_t calls, const char *indent)
+{
+    printf("%sperf per call:", indent);
+    for (int i = 0; i < VDSO_PERF_NR; i++) {
+        char name[32];
+        double v;
+
+        if (!c->valid[i] || !calls) {
+            printf(" %s n/a", vdso_perf_names[i]);
+            continue;
+        }
+        v = (double)c->value[i] / calls;
+        printf(" %s %.2f", vdso_perf_names[i], v);
+
+        snprintf(name, sizeof(name), "%s per call", vdso_perf_names[i]);
+        vdso_results_emit(name, v, vdso_perf_names[i], -1);
+    }
+    printf("\n");
+}
+
+#endif /* VDSO_PERF_H */
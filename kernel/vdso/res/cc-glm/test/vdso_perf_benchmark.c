@@ -0,0 +1,473 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * RISC-V VDSO clock_gettime Microbenchmark Harness
+ *
+ * Dedicated performance harness used by "make test-perf" and
+ * "run_tests.sh --performance". For every selected clock ID it:
+ * - warms up until the per-batch cost is stable
+ * - runs a fixed number of iterations or a fixed duration
+ * - repeats the run and reports mean, stddev and a 95% confidence interval
+ * - records a per-call latency histogram in a separate pass
+ *
+ * Build: gcc -O2 -o vdso_perf_benchmark vdso_perf_benchmark.c -lrt -lm
+ * Run:   ./vdso_perf_benchmark --clock monotonic,realtime --repeat 10 --cpu 0
+ */
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <time.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <getopt.h>
+#include <sched.h>
+#include <errno.h>
+
+#include "vdso_hist.h"
+#include "vdso_results.h"
+#include "vdso_calib.h"
+
+/* Defaults */
+#define DEFAULT_ITERATIONS      1000000
+#define DEFAULT_REPEAT          5
+#define WARMUP_BATCH            10000
+#define WARMUP_MAX_BATCHES      200
+#define WARMUP_STABLE_BATCHES   3
+#define WARMUP_TOLERANCE        0.02    /* 2% batch-to-batch variation */
+#define DURATION_CHUNK          1000
+#define HIST_SAMPLES            100000
+#define MAX_REPEAT              100
+
+/* Cycle counter access - multi-architecture support */
+static inline uint64_t rdcycle(void)
+{
+    uint64_t cycles;
+#if defined(__riscv)
+    asm volatile("rdcycle %0" : "=r"(cycles));
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned int hi, lo;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    cycles = ((uint64_t)hi << 32) | lo;
+#else
+    /* Fallback: use clock_gettime */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    cycles = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+    return cycles;
+}
+
+/* Wall time reference, independent of the clock under test */
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+struct clock_desc {
+    const char *name;
+    clockid_t id;
+};
+
+static const struct clock_desc clocks[] = {
+    { "monotonic",        CLOCK_MONOTONIC },
+    { "realtime",         CLOCK_REALTIME },
+    { "boottime",         CLOCK_BOOTTIME },
+    { "monotonic_raw",    CLOCK_MONOTONIC_RAW },
+    { "tai",              CLOCK_TAI },
+    { "monotonic_coarse", CLOCK_MONOTONIC_COARSE },
+    { "realtime_coarse",  CLOCK_REALTIME_COARSE },
+};
+#define NR_CLOCKS (sizeof(clocks) / sizeof(clocks[0]))
+
+struct perf_config {
+    bool clock_selected[NR_CLOCKS];
+    uint64_t iterations;
+    double duration_sec;        /* > 0 selects fixed-duration mode */
+    int repeat;
+    int cpu;                    /* < 0: do not pin */
+};
+
+/* One timed run */
+struct perf_run {
+    uint64_t calls;
+    uint64_t elapsed_ns;
+    uint64_t cycles;
+};
+
+/* Summary over repeated runs */
+struct perf_stats {
+    double mean;
+    double stddev;
+    double ci95;
+    double min;
+    double max;
+};
+
+/* Two-sided 95% Student t critical values, df = 1..30 */
+static const double t95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+static double t_critical(int df)
+{
+    if (df < 1)
+        return 0;
+    if (df <= (int)(sizeof(t95) / sizeof(t95[0])))
+        return t95[df - 1];
+    return 1.960;
+}
+
+static struct perf_stats compute_stats(const double *v, int n)
+{
+    struct perf_stats s = { .min = v[0], .max = v[0] };
+    double sum = 0, sq = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        sum += v[i];
+        if (v[i] < s.min)
+            s.min = v[i];
+        if (v[i] > s.max)
+            s.max = v[i];
+    }
+    s.mean = sum / n;
+
+    for (i = 0; i < n; i++)
+        sq += (v[i] - s.mean) * (v[i] - s.mean);
+
+    if (n > 1) {
+        s.stddev = sqrt(sq / (n - 1));
+        s.ci95 = t_critical(n - 1) * s.stddev / sqrt(n);
+    }
+
+    return s;
+}
+
+/* Average cycles per call over one batch */
+static double time_batch(clockid_t clk, int n)
+{
+    struct timespec ts;
+    uint64_t start, end;
+    int i;
+
+    start = rdcycle();
+    for (i = 0; i < n; i++)
+        clock_gettime(clk, &ts);
+    end = rdcycle();
+
+    return (double)(end - start) / n;
+}
+
+/*
+ * Warm up until WARMUP_STABLE_BATCHES consecutive batches agree within
+ * WARMUP_TOLERANCE, so caches, branch predictors and DVFS have settled.
+ * Returns the number of batches used; stable is cleared on give-up.
+ */
+static int warmup_until_stable(clockid_t clk, bool *stable)
+{
+    double prev = time_batch(clk, WARMUP_BATCH);
+    int batches, in_band = 0;
+
+    for (batches = 1; batches < WARMUP_MAX_BATCHES; batches++) {
+        double cur = time_batch(clk, WARMUP_BATCH);
+
+        if (fabs(cur - prev) <= prev * WARMUP_TOLERANCE) {
+            if (++in_band >= WARMUP_STABLE_BATCHES) {
+                *stable = true;
+                return batches + 1;
+            }
+        } else {
+            in_band = 0;
+        }
+        prev = cur;
+    }
+
+    *stable = false;
+    return batches;
+}
+
+static struct perf_run run_fixed_iterations(clockid_t clk, uint64_t iterations)
+{
+    struct perf_run r = { .calls = iterations };
+    struct timespec ts;
+    uint64_t t0, c0, i;
+
+    t0 = now_ns();
+    c0 = rdcycle();
+    for (i = 0; i < iterations; i++)
+        clock_gettime(clk, &ts);
+    r.cycles = rdcycle() - c0;
+    r.elapsed_ns = now_ns() - t0;
+
+    return r;
+}
+
+static struct perf_run run_fixed_duration(clockid_t clk, double duration_sec)
+{
+    struct perf_run r = { 0 };
+    struct timespec ts;
+    uint64_t t0, c0, deadline, now;
+    int i;
+
+    t0 = now_ns();
+    c0 = rdcycle();
+    deadline = t0 + (uint64_t)(duration_sec * 1e9);
+    do {
+        for (i = 0; i < DURATION_CHUNK; i++)
+            clock_gettime(clk, &ts);
+        r.calls += DURATION_CHUNK;
+        now = now_ns();
+    } while (now < deadline);
+    r.cycles = rdcycle() - c0;
+    r.elapsed_ns = now - t0;
+
+    return r;
+}
+
+static void record_latency(clockid_t clk, struct vdso_hist *h, int samples)
+{
+    struct timespec ts;
+    int i;
+
+    for (i = 0; i < samples; i++) {
+        uint64_t start = rdcycle();
+        clock_gettime(clk, &ts);
+        vdso_hist_record(h, rdcycle() - start);
+    }
+}
+
+static int bench_clock(const struct clock_desc *c, const struct perf_config *cfg,
+                       struct vdso_hist *hist)
+{
+    double ns_per_call[MAX_REPEAT], cycles_per_call[MAX_REPEAT];
+    struct perf_stats ns, cyc;
+    struct timespec ts;
+    uint64_t total_calls = 0;
+    bool stable;
+    int batches, i;
+
+    if (clock_gettime(c->id, &ts) != 0) {
+        printf("\n=== %s ===\n  unsupported: %s\n", c->name, strerror(errno));
+        return -1;
+    }
+
+    batches = warmup_until_stable(c->id, &stable);
+    vdso_calib_refresh();
+
+    for (i = 0; i < cfg->repeat; i++) {
+        struct perf_run r = cfg->duration_sec > 0 ?
+                            run_fixed_duration(c->id, cfg->duration_sec) :
+                            run_fixed_iterations(c->id, cfg->iterations);
+
+        ns_per_call[i] = (double)r.elapsed_ns / r.calls;
+        cycles_per_call[i] = (double)r.cycles / r.calls;
+        total_calls += r.calls;
+    }
+
+    ns = compute_stats(ns_per_call, cfg->repeat);
+    cyc = compute_stats(cycles_per_call, cfg->repeat);
+
+    vdso_hist_reset(hist);
+    record_latency(c->id, hist, HIST_SAMPLES);
+
+    printf("\n=== %s ===\n", c->name);
+    printf("  Warmup:          %d x %d calls (%s)\n", batches, WARMUP_BATCH,
+           stable ? "stable" : "not stable, results may be noisy");
+    printf("  Runs:            %d, %lu calls total\n", cfg->repeat,
+           (unsigned long)total_calls);
+    printf("  ns/call:         %.2f ± %.2f (95%% CI), stddev %.2f, "
+           "min %.2f, max %.2f\n", ns.mean, ns.ci95, ns.stddev, ns.min, ns.max);
+    printf("  cycles/call:     %.2f ± %.2f (95%% CI) at %.2f MHz\n",
+           cyc.mean, cyc.ci95, vdso_calib_freq_mhz());
+    printf("  calls/sec:       %.0f\n", ns.mean > 0 ? 1e9 / ns.mean : 0);
+    printf("  Latency percentiles (%d samples):\n", HIST_SAMPLES);
+    vdso_hist_print_percentiles(hist, "    ", "cycles", vdso_cycles_to_ns(1.0));
+    printf("  Latency distribution (cycles):\n");
+    vdso_hist_print_buckets(hist, "    ");
+
+    vdso_results_scope(c->name, total_calls / cfg->repeat);
+    vdso_results_emit("ns per call", ns.mean, "ns", cfg->cpu);
+    vdso_results_emit("ns per call ci95", ns.ci95, "ns", cfg->cpu);
+    vdso_results_emit("ns per call stddev", ns.stddev, "ns", cfg->cpu);
+    vdso_results_emit("cycles per call", cyc.mean, "cycles", cfg->cpu);
+    vdso_results_emit("cycles per call ci95", cyc.ci95, "cycles", cfg->cpu);
+    vdso_results_emit("calls per sec", ns.mean > 0 ? 1e9 / ns.mean : 0,
+                      "calls/sec", cfg->cpu);
+    for (i = 0; i < (int)VDSO_HIST_NR_PERCENTILES; i++) {
+        char name[32];
+
+        snprintf(name, sizeof(name), "latency p%g", vdso_hist_percentiles[i]);
+        vdso_results_emit(name,
+                          vdso_hist_percentile(hist, vdso_hist_percentiles[i]),
+                          "cycles", cfg->cpu);
+    }
+
+    return 0;
+}
+
+static int parse_clocks(struct perf_config *cfg, const char *arg)
+{
+    char *list = strdup(arg), *save = NULL, *tok;
+    unsigned int i;
+    int ret = 0;
+
+    if (!list)
+        return -1;
+
+    memset(cfg->clock_selected, 0, sizeof(cfg->clock_selected));
+    for (tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        bool found = false;
+
+        for (i = 0; i < NR_CLOCKS; i++) {
+            if (strcmp(tok, "all") == 0 || strcmp(tok, clocks[i].name) == 0) {
+                cfg->clock_selected[i] = true;
+                found = true;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "unknown clock '%s'\n", tok);
+            ret = -1;
+        }
+    }
+
+    free(list);
+    return ret;
+}
+
+static void usage(const char *prog)
+{
+    unsigned int i;
+
+    printf("Usage: %s [OPTIONS]\n", prog);
+    printf("Options:\n");
+    printf("  -c, --clock LIST      Comma-separated clocks (default: all)\n");
+    printf("  -n, --iterations N    Calls per run (default: %d)\n",
+           DEFAULT_ITERATIONS);
+    printf("  -d, --duration SEC    Run for SEC seconds instead of N calls\n");
+    printf("  -r, --repeat N        Runs per clock for the CI (default: %d, max %d)\n",
+           DEFAULT_REPEAT, MAX_REPEAT);
+    printf("  -p, --cpu CPU         Pin to CPU before measuring\n");
+    printf("      --json FILE       Append results as JSON lines\n");
+    printf("      --csv FILE        Append results as CSV\n");
+    printf("  -h, --help            Show this help\n");
+    printf("Clocks:");
+    for (i = 0; i < NR_CLOCKS; i++)
+        printf(" %s", clocks[i].name);
+    printf(" all\n");
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option long_opts[] = {
+        { "clock",      required_argument, NULL, 'c' },
+        { "iterations", required_argument, NULL, 'n' },
+        { "duration",   required_argument, NULL, 'd' },
+        { "repeat",     required_argument, NULL, 'r' },
+        { "cpu",        required_argument, NULL, 'p' },
+        { "json",       required_argument, NULL, 'J' },
+        { "csv",        required_argument, NULL, 'C' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    struct perf_config cfg = {
+        .iterations = DEFAULT_ITERATIONS,
+        .repeat = DEFAULT_REPEAT,
+        .cpu = -1,
+    };
+    struct vdso_hist *hist;
+    unsigned int i;
+    int opt, failed = 0;
+
+    for (i = 0; i < NR_CLOCKS; i++)
+        cfg.clock_selected[i] = true;
+
+    while ((opt = getopt_long(argc, argv, "c:n:d:r:p:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'c':
+            if (parse_clocks(&cfg, optarg))
+                return 2;
+            break;
+        case 'n':
+            cfg.iterations = strtoull(optarg, NULL, 0);
+            break;
+        case 'd':
+            cfg.duration_sec = atof(optarg);
+            break;
+        case 'r':
+            cfg.repeat = atoi(optarg);
+            break;
+        case 'p':
+            cfg.cpu = atoi(optarg);
+            break;
+        case 'J':
+        case 'C':
+            if (vdso_results_open(optarg, opt == 'J' ? VDSO_RESULTS_JSON :
+                                  VDSO_RESULTS_CSV, "vdso_perf_benchmark"))
+                return 2;
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (cfg.repeat < 1 || cfg.repeat > MAX_REPEAT || !cfg.iterations) {
+        fprintf(stderr, "invalid --repeat or --iterations\n");
+        return 2;
+    }
+
+    if (cfg.cpu >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(cfg.cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            perror("sched_setaffinity");
+            return 1;
+        }
+    }
+
+    hist = vdso_hist_alloc();
+    if (!hist) {
+        perror("vdso_hist_alloc");
+        return 1;
+    }
+
+    printf("==============================================\n");
+    printf("  RISC-V VDSO clock_gettime Microbenchmark\n");
+    printf("==============================================\n");
+    if (cfg.duration_sec > 0)
+        printf("Mode:   fixed duration, %.2f s per run\n", cfg.duration_sec);
+    else
+        printf("Mode:   fixed iterations, %lu calls per run\n",
+               (unsigned long)cfg.iterations);
+    printf("Repeat: %d runs per clock\n", cfg.repeat);
+    if (cfg.cpu >= 0)
+        printf("CPU:    pinned to %d\n", cfg.cpu);
+    else
+        printf("CPU:    not pinned (use --cpu for stable numbers)\n");
+    if (vdso_calib_init(rdcycle) < 0)
+        fprintf(stderr, "cycle counter calibration failed\n");
+    vdso_calib_print("        ");
+
+    for (i = 0; i < NR_CLOCKS; i++) {
+        if (cfg.clock_selected[i] && bench_clock(&clocks[i], &cfg, hist))
+            failed++;
+    }
+
+    vdso_hist_free(hist);
+    vdso_results_close();
+
+    return failed ? 1 : 0;
+}
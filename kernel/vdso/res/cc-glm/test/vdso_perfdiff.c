@@ -0,0 +1,654 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-symbol overhead diff of two `perf report` text dumps
+ *
+ * Compares a profile of the same workload on two platforms, e.g.
+ * perf_whisper_riscv_openmp_4.txt against perf_whisper_x86_openmp_4.txt.
+ * Both reports are read one line at a time. Only one record per distinct
+ * symbol is kept, so reports of hundreds of MB take no more memory than
+ * small ones.
+ *
+ * Symbols are normalized so the two platforms line up. Symbol versions
+ * (@@GLIBC_2.27) and [clone ...] suffixes are dropped. Template argument
+ * and parameter lists collapse to <> and (), and return types and the
+ * PyTorch per-ISA namespaces (AVX2, AVX512, DEFAULT, ...) are removed.
+ * Unresolved addresses are counted per shared object. --raw-symbols turns
+ * off everything except dropping the version and clone suffixes.
+ *
+ * Self overhead comes from the entry lines. Call chains in the graph
+ * (perf report -g, absolute percentages) are folded. A chain's own share,
+ * meaning its percentage minus that of its sub-chains, is added to the
+ * total overhead of every caller on it, so "total" also covers time spent
+ * below a symbol. Reports made with --children carry both columns and are
+ * taken as is. --folded prints the folded chains of one report in the
+ * "caller;...;callee weight" format of flamegraph.pl.
+ *
+ * Usage: vdso_perfdiff [--top N] [--total] [--min PCT] [--raw-symbols] BASE.txt NEW.txt
+ *        vdso_perfdiff --folded [--raw-symbols] REPORT.txt
+ *
+ * Exit status: 0 success, 2 usage or input error.
+ */
+
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_TOP     30
+#define MIN_WEIGHT      0.005   /* perf prints two decimals */
+
+struct sym {
+    char *name;
+    char dso[32];
+    uint64_t hash;
+    double self[2], total[2];
+    unsigned int stamp;         /* last chain that credited total */
+};
+
+static struct sym *syms;
+static size_t nr_syms, cap_syms;
+static uint32_t *table;         /* index + 1, 0 = empty */
+static size_t table_size;
+
+static bool raw_symbols, folded;
+
+/* One open branch of the call graph */
+struct branch {
+    int col;                    /* column of its --PCT%-- marker */
+    double pct, children;
+    size_t base;                /* chain length before its frames */
+};
+
+static struct {
+    int side;
+    bool children_mode;
+    long entry;                 /* symbol of the current entry, -1 if none */
+    double entry_pct, entry_children;
+    struct branch *stack;
+    size_t depth, cap;
+    uint32_t *chain;
+    size_t chain_len, chain_cap;
+    unsigned int stamp;
+    char samples[96];
+} ps;
+
+static char *nbuf;              /* normalized symbol */
+static size_t nbuf_cap;
+
+static void *xrealloc(void *p, size_t n)
+{
+    p = realloc(p, n);
+    if (!p) {
+        perror("realloc");
+        exit(2);
+    }
+    return p;
+}
+
+static uint64_t fnv1a(const char *s, size_t n)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    while (n--) {
+        h ^= (unsigned char)*s++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static void table_grow(void)
+{
+    size_t n = table_size ? table_size * 2 : 4096;
+
+    free(table);
+    table = calloc(n, sizeof(*table));
+    if (!table) {
+        perror("calloc");
+        exit(2);
+    }
+    table_size = n;
+    for (size_t i = 0; i < nr_syms; i++) {
+        size_t slot = syms[i].hash & (n - 1);
+
+        while (table[slot])
+            slot = (slot + 1) & (n - 1);
+        table[slot] = (uint32_t)(i + 1);
+    }
+}
+
+static uint32_t sym_get(const char *name, size_t len)
+{
+    uint64_t h = fnv1a(name, len);
+    size_t slot;
+    struct sym *s;
+
+    if (2 * (nr_syms + 1) > table_size)
+        table_grow();
+
+    for (slot = h & (table_size - 1); table[slot]; slot = (slot + 1) & (table_size - 1)) {
+        s = &syms[table[slot] - 1];
+        if (s->hash == h && strncmp(s->name, name, len) == 0 && s->name[len] == '\0')
+            return table[slot] - 1;
+    }
+
+    if (nr_syms == cap_syms) {
+        cap_syms = cap_syms ? cap_syms * 2 : 4096;
+        syms = xrealloc(syms, cap_syms * sizeof(*syms));
+    }
+    s = &syms[nr_syms];
+    memset(s, 0, sizeof(*s));
+    s->name = strndup(name, len);
+    if (!s->name) {
+        perror("strndup");
+        exit(2);
+    }
+    s->hash = h;
+    table[slot] = (uint32_t)(nr_syms + 1);
+    return (uint32_t)nr_syms++;
+}
+
+static bool is_address(const char *s, size_t n)
+{
+    if (n > 2 && s[0] == '0' && s[1] == 'x') {
+        s += 2;
+        n -= 2;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!isxdigit((unsigned char)s[i]))
+            return false;
+    }
+    return n > 0;
+}
+
+/* ATen compiles its kernels once per CPU capability, one namespace each */
+static const char *const isa_namespaces[] = {
+    "DEFAULT::", "AVX2::", "AVX512::", "ZVECTOR::", "VSX::", "SVE256::",
+};
+
+static size_t isa_namespace(const char *s, size_t n)
+{
+    for (size_t i = 0; i < sizeof(isa_namespaces) / sizeof(isa_namespaces[0]); i++) {
+        size_t l = strlen(isa_namespaces[i]);
+
+        if (l <= n && memcmp(s, isa_namespaces[i], l) == 0)
+            return l;
+    }
+    return 0;
+}
+
+/*
+ * Collapse <...> and (...) at depth 0 into <> and (), drop ISA namespaces
+ * and trailing qualifiers. Returns the length written to @out.
+ */
+static size_t collapse(const char *s, size_t n, char *out)
+{
+    static const char anon[] = "(anonymous namespace)";
+    static const char op_chars[] = "<>=!+-*/%^&|~[],";
+    size_t o = 0, i = 0, cut = 0, op_space = SIZE_MAX;
+    int angle = 0, paren = 0;
+
+    while (i < n) {
+        char c = s[i];
+
+        if (angle == 0 && paren == 0) {
+            size_t l;
+
+            if (c == '(' && n - i >= sizeof(anon) - 1 &&
+                memcmp(s + i, anon, sizeof(anon) - 1) == 0) {
+                memcpy(out + o, anon, sizeof(anon) - 1);
+                o += sizeof(anon) - 1;
+                i += sizeof(anon) - 1;
+                continue;
+            }
+            if (c == 'o' && n - i >= 8 && memcmp(s + i, "operator", 8) == 0 &&
+                (i == 0 || !isalnum((unsigned char)s[i - 1]))) {
+                memcpy(out + o, "operator", 8);
+                o += 8;
+                i += 8;
+                if (n - i >= 2 && s[i] == '(' && s[i + 1] == ')') {
+                    out[o++] = '(';
+                    out[o++] = ')';
+                    i += 2;
+                }
+                while (i < n && s[i] != '\0' && strchr(op_chars, s[i]))
+                    out[o++] = s[i++];
+                /* "operator new", "operator< <char>": not a return type */
+                if (i < n && s[i] == ' ') {
+                    op_space = o;
+                    out[o++] = s[i++];
+                }
+                continue;
+            }
+            if ((i == 0 || s[i - 1] == ':') && (l = isa_namespace(s + i, n - i))) {
+                i += l;
+                continue;
+            }
+            /* "...::operator()() const::{lambda()#1}..." */
+            if (c == ' ' && n - i >= 6 && memcmp(s + i, " const", 6) == 0 &&
+                (n - i == 6 || s[i + 6] == ':' || s[i + 6] == ' ')) {
+                i += 6;
+                continue;
+            }
+        }
+
+        if (c == '<' && paren == 0) {
+            if (angle++ == 0)
+                out[o++] = c;
+        } else if (c == '>' && paren == 0 && angle > 0) {
+            if (--angle == 0)
+                out[o++] = c;
+        } else if (c == '(' && angle == 0) {
+            if (paren++ == 0)
+                out[o++] = c;
+        } else if (c == ')' && angle == 0 && paren > 0) {
+            if (--paren == 0)
+                out[o++] = c;
+        } else if (angle == 0 && paren == 0) {
+            out[o++] = c;
+        }
+        i++;
+    }
+
+    /* "operator()() const" and the like */
+    for (;;) {
+        static const char *const quals[] = { " volatile", " &&", " &" };
+        bool stripped = false;
+
+        for (size_t q = 0; q < sizeof(quals) / sizeof(quals[0]); q++) {
+            size_t l = strlen(quals[q]);
+
+            if (o >= l && memcmp(out + o - l, quals[q], l) == 0) {
+                o -= l;
+                stripped = true;
+            }
+        }
+        if (!stripped)
+            break;
+    }
+
+    /* Return type: everything up to the last space outside the above */
+    for (size_t k = 0; k < o; k++) {
+        if (out[k] == '(' && o - k >= sizeof(anon) - 1 &&
+            memcmp(out + k, anon, sizeof(anon) - 1) == 0)
+            k += sizeof(anon) - 2;
+        else if (out[k] == ' ' && k != op_space)
+            cut = k + 1;
+    }
+    if (cut && cut < o) {
+        memmove(out, out + cut, o - cut);
+        o -= cut;
+    }
+    return o;
+}
+
+/* Normalize @s into nbuf; @dso names unresolved addresses, may be NULL */
+static size_t normalize(const char *s, size_t n, const char *dso, size_t dso_len)
+{
+    const char *at;
+
+    while (n && isspace((unsigned char)s[n - 1]))
+        n--;
+    while (n && s[n - 1] == ']') {
+        const char *clone = memmem(s, n, " [clone ", 8);
+
+        if (!clone)
+            break;
+        n = (size_t)(clone - s);
+    }
+    at = memchr(s, '@', n);
+    if (at && at > s)
+        n = (size_t)(at - s);
+
+    if (nbuf_cap < n + dso_len + 32) {
+        nbuf_cap = (n + dso_len + 32) * 2;
+        nbuf = xrealloc(nbuf, nbuf_cap);
+    }
+
+    if (is_address(s, n)) {
+        if (dso && dso_len)
+            return (size_t)snprintf(nbuf, nbuf_cap, "[unknown] %.*s", (int)dso_len, dso);
+        memcpy(nbuf, "[unknown]", 9);
+        return 9;
+    }
+    if (raw_symbols) {
+        memcpy(nbuf, s, n);
+        return n;
+    }
+    return collapse(s, n, nbuf);
+}
+
+/* libgomp.so.1.0.0 -> libgomp.so */
+static size_t dso_short(const char *dso, size_t n)
+{
+    const char *so = memmem(dso, n, ".so", 3);
+
+    return so ? (size_t)(so - dso) + 3 : n;
+}
+
+static void emit_chain(double w)
+{
+    bool reverse;
+
+    if (ps.chain_len == 0 || w < MIN_WEIGHT)
+        return;
+
+    if (folded) {
+        /* Callee-ordered graphs (perf report -G off) start at the entry */
+        reverse = ps.chain_len > 1 && ps.chain[0] == (uint32_t)ps.entry &&
+                  ps.chain[ps.chain_len - 1] != (uint32_t)ps.entry;
+        for (size_t i = 0; i < ps.chain_len; i++) {
+            size_t k = reverse ? ps.chain_len - 1 - i : i;
+
+            printf("%s%s", i ? ";" : "", syms[ps.chain[k]].name);
+        }
+        /* Sub-chains below perf's cut-off still end in the entry */
+        if (!reverse && ps.chain[ps.chain_len - 1] != (uint32_t)ps.entry)
+            printf(";%s", syms[ps.entry].name);
+        printf(" %.2f\n", w);
+        return;
+    }
+
+    ps.stamp++;
+    for (size_t i = 0; i < ps.chain_len; i++) {
+        struct sym *s = &syms[ps.chain[i]];
+
+        if ((long)ps.chain[i] == ps.entry || s->stamp == ps.stamp)
+            continue;
+        s->stamp = ps.stamp;
+        s->total[ps.side] += w;
+    }
+}
+
+static void branch_close(void)
+{
+    struct branch *b = &ps.stack[--ps.depth];
+
+    emit_chain(b->pct - b->children);
+    ps.chain_len = b->base;
+}
+
+static void graph_end(void)
+{
+    while (ps.depth)
+        branch_close();
+    if (folded && ps.entry >= 0 && ps.entry_pct - ps.entry_children >= MIN_WEIGHT)
+        printf("%s %.2f\n", syms[ps.entry].name, ps.entry_pct - ps.entry_children);
+    ps.entry = -1;
+}
+
+/* "    13.27%  python3  [vdso]  [.] __vdso_clock_gettime" */
+static bool parse_entry(const char *line, size_t len)
+{
+    const char *p = line, *marker, *dso, *dso_end, *sym;
+    double pct, self;
+    char *end;
+    uint32_t id;
+
+    while (*p == ' ')
+        p++;
+    if (!isdigit((unsigned char)*p))
+        return false;
+    pct = strtod(p, &end);
+    if (*end != '%')
+        return false;
+    p = end + 1;
+    self = pct;
+
+    /* --children: "Children  Self" */
+    while (*p == ' ')
+        p++;
+    if (isdigit((unsigned char)*p)) {
+        double v = strtod(p, &end);
+
+        if (*end == '%') {
+            self = v;
+            p = end + 1;
+            ps.children_mode = true;
+        }
+    }
+
+    /* "[.] " or "[k] "; the shared object may be "[vdso]" */
+    for (marker = strstr(p, "] "); marker; marker = strstr(marker + 1, "] ")) {
+        if (marker - p >= 3 && marker[-2] == '[' && marker[-3] == ' ')
+            break;
+    }
+    if (!marker)
+        return false;
+    sym = marker + 2;
+    marker -= 2;
+
+    for (dso_end = marker; dso_end > p && dso_end[-1] == ' '; dso_end--)
+        ;
+    for (dso = dso_end; dso > p && dso[-1] != ' '; dso--)
+        ;
+
+    graph_end();
+
+    len = normalize(sym, len - (size_t)(sym - line), dso,
+                    dso_short(dso, (size_t)(dso_end - dso)));
+    id = sym_get(nbuf, len);
+    if (!syms[id].dso[0])
+        snprintf(syms[id].dso, sizeof(syms[id].dso), "%.*s",
+                 (int)dso_short(dso, (size_t)(dso_end - dso)), dso);
+
+    syms[id].self[ps.side] += self;
+    syms[id].total[ps.side] += ps.children_mode ? pct : self;
+    ps.entry = id;
+    ps.entry_pct = self;
+    ps.entry_children = 0;
+    return true;
+}
+
+static void chain_push(uint32_t id)
+{
+    if (ps.chain_len == ps.chain_cap) {
+        ps.chain_cap = ps.chain_cap ? ps.chain_cap * 2 : 256;
+        ps.chain = xrealloc(ps.chain, ps.chain_cap * sizeof(*ps.chain));
+    }
+    ps.chain[ps.chain_len++] = id;
+}
+
+/*
+ * Call-graph lines, caller order:
+ *            |--2.96%--float at::vec::map_reduce_all<...>
+ *            |          expf@@GLIBC_2.27
+ * A deeper --PCT%-- marker opens a sub-chain, one at the same column a
+ * sibling. "---" is a lone chain that takes whatever its parent has left.
+ */
+static void parse_graph(const char *line, size_t len)
+{
+    const char *p = line, *end = line + len;
+    int col;
+
+    if (ps.entry < 0 || ps.children_mode)
+        return;
+    while (p < end && (*p == ' ' || *p == '|'))
+        p++;
+    col = (int)(p - line);
+    if (p == end || *p == '\n')
+        return;
+
+    if (end - p >= 2 && p[0] == '-' && p[1] == '-') {
+        struct branch *parent, *b;
+        double pct, left;
+        char *e;
+
+        while (ps.depth && ps.stack[ps.depth - 1].col >= col)
+            branch_close();
+        parent = ps.depth ? &ps.stack[ps.depth - 1] : NULL;
+        left = parent ? parent->pct - parent->children : ps.entry_pct - ps.entry_children;
+
+        if (p[2] == '-') {
+            pct = left;
+            p += 3;
+        } else {
+            pct = strtod(p + 2, &e);
+            if (e[0] != '%' || e[1] != '-' || e[2] != '-')
+                return;
+            p = e + 3;
+        }
+        if (parent)
+            parent->children += pct;
+        else
+            ps.entry_children += pct;
+
+        if (ps.depth == ps.cap) {
+            ps.cap = ps.cap ? ps.cap * 2 : 32;
+            ps.stack = xrealloc(ps.stack, ps.cap * sizeof(*ps.stack));
+        }
+        b = &ps.stack[ps.depth++];
+        b->col = col;
+        b->pct = pct;
+        b->children = 0;
+        b->base = ps.chain_len;
+    } else if (!ps.depth) {
+        return;
+    }
+
+    len = normalize(p, (size_t)(end - p), NULL, 0);
+    chain_push(sym_get(nbuf, len));
+}
+
+static int load(const char *path, int side)
+{
+    FILE *f = fopen(path, "r");
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    memset(&ps, 0, sizeof(ps));
+    ps.side = side;
+    ps.entry = -1;
+
+    while ((len = getline(&line, &cap, f)) > 0) {
+        if (line[0] == '#') {
+            if (!ps.samples[0] && strncmp(line, "# Samples: ", 11) == 0)
+                snprintf(ps.samples, sizeof(ps.samples), "%.*s",
+                         (int)strcspn(line + 11, "\n"), line + 11);
+            continue;
+        }
+        if (line[0] == '\n') {
+            graph_end();
+            continue;
+        }
+        if (!parse_entry(line, (size_t)len))
+            parse_graph(line, (size_t)len);
+    }
+    graph_end();
+
+    free(ps.stack);
+    free(ps.chain);
+    free(line);
+    fclose(f);
+    return 0;
+}
+
+static int sort_metric;         /* 0 self, 1 total */
+
+static double delta_of(const struct sym *s)
+{
+    const double *v = sort_metric ? s->total : s->self;
+
+    return v[1] - v[0];
+}
+
+static int cmp_delta(const void *a, const void *b)
+{
+    double da = fabs(delta_of(&syms[*(const uint32_t *)a]));
+    double db = fabs(delta_of(&syms[*(const uint32_t *)b]));
+
+    return (da < db) - (da > db);
+}
+
+int main(int argc, char **argv)
+{
+    const char *files[2] = { NULL, NULL };
+    char samples[2][96];
+    int nr_files = 0, top = DEFAULT_TOP;
+    double min_pct = 0, sum[2] = { 0, 0 };
+    uint32_t *order;
+    size_t n = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            top = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--min") == 0 && i + 1 < argc) {
+            min_pct = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--total") == 0) {
+            sort_metric = 1;
+        } else if (strcmp(argv[i], "--raw-symbols") == 0) {
+            raw_symbols = true;
+        } else if (strcmp(argv[i], "--folded") == 0) {
+            folded = true;
+        } else if (argv[i][0] != '-' && nr_files < 2) {
+            files[nr_files++] = argv[i];
+        } else {
+            nr_files = -1;
+            break;
+        }
+    }
+    if (nr_files != (folded ? 1 : 2)) {
+        fprintf(stderr,
+                "Usage: %s [--top N] [--total] [--min PCT] [--raw-symbols] BASE.txt NEW.txt\n"
+                "       %s --folded [--raw-symbols] REPORT.txt\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    for (int side = 0; side < nr_files; side++) {
+        if (load(files[side], side) < 0)
+            return 2;
+        memcpy(samples[side], ps.samples, sizeof(samples[side]));
+    }
+    if (folded)
+        return 0;
+
+    order = malloc((nr_syms ? nr_syms : 1) * sizeof(*order));
+    if (!order) {
+        perror("malloc");
+        return 2;
+    }
+    for (size_t i = 0; i < nr_syms; i++) {
+        const struct sym *s = &syms[i];
+        const double *v = sort_metric ? s->total : s->self;
+
+        sum[0] += s->self[0];
+        sum[1] += s->self[1];
+        if (v[0] < MIN_WEIGHT && v[1] < MIN_WEIGHT)
+            continue;
+        if (v[0] < min_pct && v[1] < min_pct)
+            continue;
+        order[n++] = (uint32_t)i;
+    }
+    qsort(order, n, sizeof(*order), cmp_delta);
+    if (top > 0 && (size_t)top < n)
+        n = (size_t)top;
+
+    printf("Base: %s (%s, %.2f%% attributed)\n", files[0],
+           samples[0][0] ? samples[0] : "no sample count", sum[0]);
+    printf("New:  %s (%s, %.2f%% attributed)\n", files[1],
+           samples[1][0] ? samples[1] : "no sample count", sum[1]);
+    printf("Ranked by |delta| of %s overhead, %zu distinct symbols\n\n",
+           sort_metric ? "total" : "self", nr_syms);
+    printf("%8s %8s %8s %9s %9s  %-24s %s\n", "Base%", "New%", "Delta", "BaseTot%",
+           "NewTot%", "Shared Object", "Symbol");
+
+    for (size_t i = 0; i < n; i++) {
+        const struct sym *s = &syms[order[i]];
+
+        printf("%8.2f %8.2f %+8.2f %9.2f %9.2f  %-24.24s %s\n", s->self[0], s->self[1],
+               s->self[1] - s->self[0], s->total[0], s->total[1],
+               s->dso[0] ? s->dso : "-", s->name);
+    }
+
+    free(order);
+    return 0;
+}
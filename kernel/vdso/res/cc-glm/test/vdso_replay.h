@@ -0,0 +1,390 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Workload replay: clock_gettime() call patterns of OpenMP-style programs
+ *
+ * Each of N threads alternates busy work and clock_gettime(), with the
+ * work between two calls drawn from an inter-call gap distribution, and
+ * all threads meet at a barrier every few calls, like the parallel
+ * regions of libtorch under libgomp (perf_whisper_riscv_openmp_4.txt).
+ * The end-to-end time of a fixed number of regions gives throughput for
+ * the whole mix rather than for the call alone.
+ *
+ * Gap models (@spec of vdso_replay_parse()):
+ *
+ *   const:NS              every gap NS nanoseconds
+ *   exp:MEAN              exponential with mean MEAN ns
+ *   lognormal:MEDIAN:SIGMA
+ *   file:PATH             one gap in ns per line ('#' comments)
+ *   trace:PATH            `perf script` output of a clock_gettime probe;
+ *                         gaps between consecutive calls of the same tid
+ *   whisper               lognormal (sigma 1) whose mean gives the call
+ *                         the 17.5% share of samples seen in the whisper
+ *                         profile (13.27% vDSO + 4.26% libc) at the
+ *                         uncached call cost
+ *
+ * Needs vdso_calib_init() to have selected the cycle reader.
+ */
+
+#ifndef VDSO_REPLAY_H
+#define VDSO_REPLAY_H
+
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vdso_calib.h"
+#include "vdso_breakdown.h"
+
+#define VDSO_REPLAY_TABLE       4096    /* pre-drawn gaps per thread */
+#define VDSO_REPLAY_MAX_THREADS 256
+#define VDSO_REPLAY_WHISPER_SHARE 0.175
+
+enum vdso_replay_kind {
+    VDSO_REPLAY_CONST,
+    VDSO_REPLAY_EXP,
+    VDSO_REPLAY_LOGNORMAL,
+    VDSO_REPLAY_EMPIRICAL,
+};
+
+struct vdso_replay_model {
+    enum vdso_replay_kind kind;
+    double a, b;                /* const: a; exp: mean a; lognormal: median a, sigma b */
+    double *samples;            /* empirical gaps, ns */
+    size_t nr_samples;
+    char desc[96];
+};
+
+struct vdso_replay_config {
+    int threads;
+    int calls_per_barrier;
+    double duration_ns;         /* target; turned into a region count */
+    int (*gettime)(clockid_t, struct timespec *);
+    bool force_counter_read;    /* add one hardware counter read per call */
+};
+
+struct vdso_replay_result {
+    uint64_t regions;
+    uint64_t calls;
+    double seconds;
+    double calls_per_sec;
+    double regions_per_sec;
+};
+
+/* xorshift64*, one stream per thread */
+static inline double vdso_replay_uniform(uint64_t *s)
+{
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return ((*s * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static inline double vdso_replay_draw(const struct vdso_replay_model *m, uint64_t *s)
+{
+    double u = vdso_replay_uniform(s);
+
+    switch (m->kind) {
+    case VDSO_REPLAY_CONST:
+        return m->a;
+    case VDSO_REPLAY_EXP:
+        return -m->a * log(1.0 - u);
+    case VDSO_REPLAY_LOGNORMAL: {
+        /* Box-Muller */
+        double z = sqrt(-2.0 * log(1.0 - u)) *
+                   cos(2.0 * M_PI * vdso_replay_uniform(s));
+
+        return m->a * exp(m->b * z);
+    }
+    case VDSO_REPLAY_EMPIRICAL:
+        return m->samples[(size_t)(u * m->nr_samples)];
+    }
+    return 0;
+}
+
+static inline double vdso_replay_mean_ns(const struct vdso_replay_model *m)
+{
+    double sum = 0;
+
+    switch (m->kind) {
+    case VDSO_REPLAY_CONST:
+    case VDSO_REPLAY_EXP:
+        return m->a;
+    case VDSO_REPLAY_LOGNORMAL:
+        return m->a * exp(m->b * m->b / 2);
+    case VDSO_REPLAY_EMPIRICAL:
+        for (size_t i = 0; i < m->nr_samples; i++)
+            sum += m->samples[i];
+        return m->nr_samples ? sum / m->nr_samples : 0;
+    }
+    return 0;
+}
+
+static inline int vdso_replay_push(struct vdso_replay_model *m, double gap,
+                                   size_t *cap)
+{
+    if (m->nr_samples == *cap) {
+        size_t n = *cap ? *cap * 2 : 1024;
+        double *p = realloc(m->samples, n * sizeof(*p));
+
+        if (!p)
+            return -1;
+        m->samples = p;
+        *cap = n;
+    }
+    m->samples[m->nr_samples++] = gap;
+    return 0;
+}
+
+/* file: one gap per line; trace: perf script lines "comm [pid/]tid [cpu] sec.usec: ..." */
+static inline int vdso_replay_load(struct vdso_replay_model *m, const char *path,
+                                   bool trace)
+{
+    enum { NR_TIDS = 64 };
+    struct { long tid; double ts; } last[NR_TIDS];
+    int nr_tids = 0, i;
+    size_t cap = 0;
+    char line[1024];
+    FILE *fp = fopen(path, "r");
+
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        char *tok, *save = NULL;
+        long tid = -1;
+        double ts = -1;
+
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        if (!trace) {
+            double gap = strtod(line, NULL);
+
+            if (gap > 0 && vdso_replay_push(m, gap, &cap) < 0)
+                goto err;
+            continue;
+        }
+
+        /* The timestamp is the first "digits.digits:" token, the tid the last number before it */
+        for (tok = strtok_r(line, " \t", &save); tok; tok = strtok_r(NULL, " \t", &save)) {
+            size_t len = strlen(tok);
+            char *end;
+
+            if (len > 1 && tok[len - 1] == ':' && strchr(tok, '.') &&
+                isdigit((unsigned char)tok[0])) {
+                ts = strtod(tok, &end);
+                if (*end == ':')
+                    break;
+                ts = -1;
+            } else if (isdigit((unsigned char)tok[0])) {
+                /* "pid/tid" (perf script with both fields) or a bare tid */
+                tid = strtol(tok, &end, 10);
+                if (*end == '/' && isdigit((unsigned char)end[1]))
+                    tid = strtol(end + 1, &end, 10);
+                if (*end)
+                    tid = -1;
+            }
+        }
+        if (ts < 0 || tid < 0)
+            continue;
+
+        for (i = 0; i < nr_tids && last[i].tid != tid; i++)
+            ;
+        if (i == nr_tids) {
+            if (nr_tids == NR_TIDS)
+                continue;
+            last[nr_tids].tid = tid;
+            last[nr_tids++].ts = ts;
+            continue;
+        }
+        if (ts > last[i].ts && vdso_replay_push(m, (ts - last[i].ts) * 1e9, &cap) < 0)
+            goto err;
+        last[i].ts = ts;
+    }
+    fclose(fp);
+
+    if (!m->nr_samples) {
+        fprintf(stderr, "%s: no gaps found\n", path);
+        return -1;
+    }
+    return 0;
+
+err:
+    fclose(fp);
+    return -1;
+}
+
+/*
+ * Parse @spec into @m. @call_ns is the uncached cost of one call, used
+ * by the "whisper" preset. Returns 0 or -1 with a message on stderr.
+ */
+static inline int vdso_replay_parse(struct vdso_replay_model *m, const char *spec,
+                                    double call_ns)
+{
+    memset(m, 0, sizeof(*m));
+
+    if (strcmp(spec, "whisper") == 0) {
+        double mean = call_ns * (1 - VDSO_REPLAY_WHISPER_SHARE) /
+                      VDSO_REPLAY_WHISPER_SHARE;
+
+        m->kind = VDSO_REPLAY_LOGNORMAL;
+        m->b = 1.0;
+        m->a = mean / exp(m->b * m->b / 2);
+    } else if (sscanf(spec, "const:%lf", &m->a) == 1) {
+        m->kind = VDSO_REPLAY_CONST;
+    } else if (sscanf(spec, "exp:%lf", &m->a) == 1) {
+        m->kind = VDSO_REPLAY_EXP;
+    } else if (sscanf(spec, "lognormal:%lf:%lf", &m->a, &m->b) == 2) {
+        m->kind = VDSO_REPLAY_LOGNORMAL;
+    } else if (strncmp(spec, "file:", 5) == 0 || strncmp(spec, "trace:", 6) == 0) {
+        bool trace = spec[0] == 't';
+
+        m->kind = VDSO_REPLAY_EMPIRICAL;
+        if (vdso_replay_load(m, strchr(spec, ':') + 1, trace) < 0)
+            return -1;
+    } else {
+        fprintf(stderr, "unknown gap model '%s'\n", spec);
+        return -1;
+    }
+
+    if (m->kind != VDSO_REPLAY_EMPIRICAL && m->a <= 0) {
+        fprintf(stderr, "gap model '%s': gap must be positive\n", spec);
+        return -1;
+    }
+    snprintf(m->desc, sizeof(m->desc), "%s, mean gap %.0f ns", spec,
+             vdso_replay_mean_ns(m));
+    return 0;
+}
+
+static inline void vdso_replay_free(struct vdso_replay_model *m)
+{
+    free(m->samples);
+    m->samples = NULL;
+    m->nr_samples = 0;
+}
+
+struct vdso_replay_worker {
+    pthread_t thread;
+    pthread_barrier_t *barrier;
+    int *gate;                          /* 0 wait, 1 run, -1 abort */
+    const struct vdso_replay_config *cfg;
+    uint64_t regions;
+    uint64_t gaps[VDSO_REPLAY_TABLE];   /* cycles */
+    uint64_t start, end;                /* set by worker 0 */
+    int id;
+};
+
+static volatile uint64_t vdso_replay_sink;
+
+static inline void *vdso_replay_thread(void *arg)
+{
+    struct vdso_replay_worker *w = arg;
+    const struct vdso_replay_config *cfg = w->cfg;
+    uint64_t (*rd)(void) = vdso_calib.read_cycles;
+    unsigned int g = 0;
+    struct timespec ts;
+    uint64_t acc = 0;
+    int go;
+
+    /* Held until every worker exists: the barrier only releases all @nr */
+    while ((go = __atomic_load_n(w->gate, __ATOMIC_ACQUIRE)) == 0)
+        sched_yield();
+    if (go < 0)
+        return NULL;
+
+    pthread_barrier_wait(w->barrier);
+    if (w->id == 0)
+        w->start = rd();
+
+    for (uint64_t r = 0; r < w->regions; r++) {
+        for (int c = 0; c < cfg->calls_per_barrier; c++) {
+            uint64_t t0 = rd(), gap = w->gaps[g++ % VDSO_REPLAY_TABLE];
+
+            while (rd() - t0 < gap)
+                ;
+            cfg->gettime(CLOCK_MONOTONIC, &ts);
+            if (cfg->force_counter_read)
+                acc += vdso_bd_read_counter();
+            acc += ts.tv_nsec;
+        }
+        pthread_barrier_wait(w->barrier);
+    }
+
+    if (w->id == 0)
+        w->end = rd();
+    vdso_replay_sink = acc;
+    return NULL;
+}
+
+/* Replay @m under @cfg; gaps are pre-drawn so the loop only spins */
+static inline int vdso_replay_run(const struct vdso_replay_model *m,
+                                  const struct vdso_replay_config *cfg,
+                                  struct vdso_replay_result *res)
+{
+    const struct vdso_calib_hart *h = vdso_calib_get(sched_getcpu());
+    double mean = vdso_replay_mean_ns(m);
+    struct vdso_replay_worker *w;
+    pthread_barrier_t barrier;
+    uint64_t regions;
+    int nr = cfg->threads, gate = 0, started;
+
+    if (!h || h->cycles_per_ns <= 0 || mean <= 0 || nr < 1 ||
+        nr > VDSO_REPLAY_MAX_THREADS || cfg->calls_per_barrier < 1)
+        return -1;
+
+    regions = (uint64_t)(cfg->duration_ns / (mean * cfg->calls_per_barrier));
+    if (regions < 1)
+        regions = 1;
+
+    w = calloc(nr, sizeof(*w));
+    if (!w)
+        return -1;
+
+    pthread_barrier_init(&barrier, NULL, nr);
+    for (int i = 0; i < nr; i++) {
+        /* Same seeds for every run, so on/off replay identical gaps */
+        uint64_t seed = 0x9e3779b97f4a7c15ULL * (i + 1);
+
+        w[i].barrier = &barrier;
+        w[i].gate = &gate;
+        w[i].cfg = cfg;
+        w[i].regions = regions;
+        w[i].id = i;
+        for (int j = 0; j < VDSO_REPLAY_TABLE; j++)
+            w[i].gaps[j] = (uint64_t)(vdso_replay_draw(m, &seed) * h->cycles_per_ns);
+    }
+    for (started = 0; started < nr; started++) {
+        if (pthread_create(&w[started].thread, NULL, vdso_replay_thread,
+                           &w[started]) != 0) {
+            perror("pthread_create");
+            break;
+        }
+    }
+    /* A partial set would deadlock in the barrier: send it home instead */
+    __atomic_store_n(&gate, started == nr ? 1 : -1, __ATOMIC_RELEASE);
+    for (int i = 0; i < started; i++)
+        pthread_join(w[i].thread, NULL);
+    pthread_barrier_destroy(&barrier);
+    if (started != nr) {
+        free(w);
+        return -1;
+    }
+
+    res->regions = regions;
+    res->calls = regions * cfg->calls_per_barrier * nr;
+    res->seconds = (w[0].end - w[0].start) / h->cycles_per_ns / 1e9;
+    res->calls_per_sec = res->seconds > 0 ? res->calls / res->seconds : 0;
+    res->regions_per_sec = res->seconds > 0 ? regions / res->seconds : 0;
+
+    free(w);
+    return 0;
+}
+
+#endif /* VDSO_REPLAY_H */
@@ -0,0 +1,300 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Machine-readable result emitter shared by the benchmark and test suite
+ *
+ * Every metric is written as one record carrying its name, value, unit,
+ * iteration count, the hart it was measured on and the kernel and
+ * architecture it ran under, either as JSON lines or as CSV. With a
+ * cycles -> ns converter installed (vdso_timing.h), a metric in cycles is
+ * followed by the same metric in ns, which compares across architectures.
+ * Files are opened in append mode so that several runs (or both binaries)
+ * can feed the same file; a CSV header is only written to an empty file.
+ *
+ * Human-readable output is unaffected: emitting is a no-op until
+ * vdso_results_open() has succeeded.
+ */
+
+#ifndef VDSO_RESULTS_H
+#define VDSO_RESULTS_H
+
+#include <ctype.h>
+#include <math.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/utsname.h>
+
+enum vdso_results_format {
+    VDSO_RESULTS_JSON,
+    VDSO_RESULTS_CSV,
+};
+
+struct vdso_results {
+    FILE *fp;
+    enum vdso_results_format format;
+    const char *suite;
+    char kernel[65];
+    char arch[65];
+    char time_cache[16];
+    char scope[64];
+    uint64_t iterations;
+    double (*cycles_to_ns)(double cycles, int hart);
+};
+
+static struct vdso_results vdso_results;
+
+/*
+ * Value of kernel config option @opt from /proc/config.gz or
+ * /boot/config-$(uname -r): "y", a number, "n" if not set. Returns false
+ * if neither config source has the option.
+ */
+static inline bool vdso_kconfig_get(const char *opt, char *buf, size_t len)
+{
+    char cmd[256], line[256], *eq;
+    struct utsname uts;
+    bool found = false;
+    FILE *fp;
+
+    if (uname(&uts) != 0)
+        return false;
+
+    snprintf(cmd, sizeof(cmd),
+             "{ zcat /proc/config.gz || cat /boot/config-%s; } 2>/dev/null | "
+             "grep -E '^(# )?%s[= ]'", uts.release, opt);
+
+    fp = popen(cmd, "r");
+    if (!fp)
+        return false;
+
+    if (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+        if ((eq = strchr(line, '=')) != NULL) {
+            snprintf(buf, len, "%s", eq + 1);
+            found = true;
+        } else if (strstr(line, "is not set")) {
+            snprintf(buf, len, "n");
+            found = true;
+        }
+    }
+    pclose(fp);
+    return found;
+}
+
+/* "y", "n" or "unknown" for CONFIG_RISCV_VDSO_TIME_CACHE */
+static inline void vdso_results_probe_config(char *buf, size_t len)
+{
+    if (!vdso_kconfig_get("CONFIG_RISCV_VDSO_TIME_CACHE", buf, len))
+        snprintf(buf, len, "unknown");
+}
+
+/* uname -m, e.g. "riscv64" or "x86_64" */
+static inline const char *vdso_results_arch(void)
+{
+    struct utsname uts;
+
+    if (!vdso_results.arch[0])
+        snprintf(vdso_results.arch, sizeof(vdso_results.arch), "%s",
+                 uname(&uts) == 0 ? uts.machine : "unknown");
+    return vdso_results.arch;
+}
+
+static inline void vdso_results_close(void)
+{
+    if (vdso_results.fp && vdso_results.fp != stdout)
+        fclose(vdso_results.fp);
+    else if (vdso_results.fp)
+        fflush(vdso_results.fp);
+    vdso_results.fp = NULL;
+}
+
+static inline int vdso_results_open(const char *path,
+                                    enum vdso_results_format format,
+                                    const char *suite)
+{
+    struct utsname uts;
+
+    /* Only one file at a time; vdso_results_parse_arg() rejects a second */
+    vdso_results_close();
+
+    if (strcmp(path, "-") == 0)
+        vdso_results.fp = stdout;
+    else
+        vdso_results.fp = fopen(path, "a");
+    if (!vdso_results.fp) {
+        perror(path);
+        return -1;
+    }
+
+    vdso_results.format = format;
+    vdso_results.suite = suite;
+    snprintf(vdso_results.kernel, sizeof(vdso_results.kernel), "%s",
+             uname(&uts) == 0 ? uts.release : "unknown");
+    vdso_results_arch();
+    vdso_results_probe_config(vdso_results.time_cache,
+                              sizeof(vdso_results.time_cache));
+
+    if (format == VDSO_RESULTS_CSV && ftell(vdso_results.fp) == 0) {
+        fprintf(vdso_results.fp,
+                "suite,name,value,unit,iterations,hart,kernel,time_cache,arch\n");
+    }
+
+    return 0;
+}
+
+/*
+ * Prefix and iteration count applied to subsequent vdso_results_emit()
+ * calls, e.g. vdso_results_scope("P001", 1000).
+ */
+static inline void vdso_results_scope(const char *scope, uint64_t iterations)
+{
+    snprintf(vdso_results.scope, sizeof(vdso_results.scope), "%s", scope);
+    vdso_results.iterations = iterations;
+}
+
+/* "  Min latency" -> "min_latency" */
+static inline void vdso_results_slug(char *dst, size_t len, const char *src)
+{
+    size_t n = 0;
+    bool sep = false;
+
+    while (*src && isspace((unsigned char)*src))
+        src++;
+
+    for (; *src && n + 1 < len; src++) {
+        unsigned char c = *src;
+
+        if (isalnum(c) || c == '.') {
+            if (sep && n)
+                dst[n++] = '_';
+            if (n + 1 < len)
+                dst[n++] = tolower(c);
+            sep = false;
+        } else {
+            sep = true;
+        }
+    }
+    dst[n] = '\0';
+}
+
+/* Write @s as a JSON string or CSV field */
+static inline void vdso_results_put_str(const char *s)
+{
+    FILE *fp = vdso_results.fp;
+
+    fputc('"', fp);
+    for (; *s; s++) {
+        if (vdso_results.format == VDSO_RESULTS_JSON &&
+            (*s == '"' || *s == '\\'))
+            fputc('\\', fp);
+        else if (vdso_results.format == VDSO_RESULTS_CSV && *s == '"')
+            fputc('"', fp);
+        fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+/*
+ * Emit one metric. @name is slugified and prefixed with the current scope;
+ * @hart < 0 records the hart the caller is running on. A metric in cycles
+ * is repeated in ns when a converter is installed, named with "cycles"
+ * replaced by "ns" or, failing that, with " ns" appended.
+ */
+static inline void vdso_results_emit(const char *name, double value,
+                                     const char *unit, int hart)
+{
+    char full[160], slug[96];
+    FILE *fp = vdso_results.fp;
+    bool json;
+
+    /* JSON has no nan/inf and readers would parse them as 0: drop the record */
+    if (!fp || !isfinite(value))
+        return;
+
+    json = vdso_results.format == VDSO_RESULTS_JSON;
+    if (hart < 0)
+        hart = sched_getcpu();
+
+    vdso_results_slug(slug, sizeof(slug), name);
+    if (vdso_results.scope[0])
+        snprintf(full, sizeof(full), "%s.%s", vdso_results.scope, slug);
+    else
+        snprintf(full, sizeof(full), "%s", slug);
+
+    if (json) {
+        fputs("{\"suite\":", fp);
+        vdso_results_put_str(vdso_results.suite);
+        fputs(",\"name\":", fp);
+        vdso_results_put_str(full);
+        fprintf(fp, ",\"value\":%.9g,\"unit\":", value);
+        vdso_results_put_str(unit);
+        fprintf(fp, ",\"iterations\":%lu,\"hart\":%d,\"kernel\":",
+                (unsigned long)vdso_results.iterations, hart);
+        vdso_results_put_str(vdso_results.kernel);
+        fputs(",\"time_cache\":", fp);
+        vdso_results_put_str(vdso_results.time_cache);
+        fputs(",\"arch\":", fp);
+        vdso_results_put_str(vdso_results.arch);
+        fputs("}\n", fp);
+    } else {
+        vdso_results_put_str(vdso_results.suite);
+        fputc(',', fp);
+        vdso_results_put_str(full);
+        fprintf(fp, ",%.9g,", value);
+        vdso_results_put_str(unit);
+        fprintf(fp, ",%lu,%d,", (unsigned long)vdso_results.iterations, hart);
+        vdso_results_put_str(vdso_results.kernel);
+        fputc(',', fp);
+        vdso_results_put_str(vdso_results.time_cache);
+        fputc(',', fp);
+        vdso_results_put_str(vdso_results.arch);
+        fputc('\n', fp);
+    }
+
+    if (vdso_results.cycles_to_ns && strcmp(unit, "cycles") == 0) {
+        double ns = vdso_results.cycles_to_ns(value, hart);
+        const char *w = strstr(name, "cycles");
+        char ns_name[96];
+
+        if (ns <= 0 && value != 0)
+            return;
+        if (w)
+            snprintf(ns_name, sizeof(ns_name), "%.*sns%s", (int)(w - name), name,
+                     w + strlen("cycles"));
+        else
+            snprintf(ns_name, sizeof(ns_name), "%s ns", name);
+        vdso_results_emit(ns_name, ns, "ns", hart);
+    }
+}
+
+/*
+ * Parse "--json FILE" / "--csv FILE" at argv[*i]. Returns 1 if consumed
+ * (advancing *i), 0 if not a results option, -1 on error.
+ */
+static inline int vdso_results_parse_arg(int argc, char **argv, int *i,
+                                         const char *suite)
+{
+    enum vdso_results_format format;
+
+    if (strcmp(argv[*i], "--json") == 0)
+        format = VDSO_RESULTS_JSON;
+    else if (strcmp(argv[*i], "--csv") == 0)
+        format = VDSO_RESULTS_CSV;
+    else
+        return 0;
+
+    if (*i + 1 >= argc) {
+        fprintf(stderr, "%s requires a file argument\n", argv[*i]);
+        return -1;
+    }
+    if (vdso_results.fp) {
+        fprintf(stderr, "only one of --json/--csv may be given\n");
+        return -1;
+    }
+
+    (*i)++;
+    return vdso_results_open(argv[*i], format, suite) == 0 ? 1 : -1;
+}
+
+#endif /* VDSO_RESULTS_H */
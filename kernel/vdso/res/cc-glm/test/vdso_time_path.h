@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Per-hart time path selection (native CSR_TIME vs. time cache)
+ *
+ * With riscv-vdso-cache-patch-fix/0010 every hart times its CSR_TIME
+ * reads when it comes online and is classed native or emulated. The vDSO
+ * reads CSR_TIME directly while all online harts are native and uses the
+ * time cache otherwise. __vdso_riscv_time_path() reports both: the
+ * selection with cpu < 0 and each hart's class with its number.
+ *
+ * The same measurement is repeated here from user space on every hart,
+ * so the table also means something on kernels without the export: it
+ * then shows which path each hart would get. The hart's mvendorid and
+ * marchid come from riscv_hwprobe() with a one-hart cpuset, which tells
+ * the core types of a heterogeneous SoC apart.
+ *
+ * Needs vdso_calib_init() to have selected the cycle reader.
+ */
+
+#ifndef VDSO_TIME_PATH_H
+#define VDSO_TIME_PATH_H
+
+#include <dlfcn.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "vdso_breakdown.h"
+#include "vdso_calib.h"
+
+#define VDSO_TIME_PATH_NATIVE_CYCLES    50      /* CONFIG_RISCV_VDSO_TIME_NATIVE_CYCLES */
+#define VDSO_TIME_PATH_READS            256     /* brackets per hart, cheapest kept */
+#define VDSO_TIME_PATH_MAX_HARTS        256
+
+/* VDSO_TIME_CSR_* in asm/vdso/arch_data.h */
+enum vdso_time_csr {
+    VDSO_TIME_CSR_UNKNOWN,
+    VDSO_TIME_CSR_EMULATED,
+    VDSO_TIME_CSR_NATIVE,
+};
+
+static const char *const vdso_time_csr_names[] = {
+    "unknown", "emulated", "native",
+};
+
+struct vdso_time_path_hart {
+    int cpu;
+    double read_cycles;         /* cheapest counter read, net of rdcycle */
+    enum vdso_time_csr measured;
+    int kernel;                 /* kernel's class, -1 if not exported */
+    bool has_ids;
+    uint64_t mvendorid, marchid;
+};
+
+typedef int (*vdso_time_path_fn)(int cpu);
+
+static struct {
+    bool probed;
+    vdso_time_path_fn fn;
+} vdso_time_path;
+
+/* Resolve __vdso_riscv_time_path once; NULL if the vDSO lacks it */
+static inline vdso_time_path_fn vdso_time_path_lookup(void)
+{
+    void *h;
+
+    if (vdso_time_path.probed)
+        return vdso_time_path.fn;
+    vdso_time_path.probed = true;
+
+    h = dlopen("linux-vdso.so.1", RTLD_NOW | RTLD_NOLOAD);
+    if (!h)
+        return NULL;
+    vdso_time_path.fn = (vdso_time_path_fn)dlsym(h, "__vdso_riscv_time_path");
+    return vdso_time_path.fn;
+}
+
+/* 1 direct, 0 cached, -1 if the kernel does not say */
+static inline int vdso_time_path_selected(void)
+{
+    vdso_time_path_fn fn = vdso_time_path_lookup();
+
+    return fn ? fn(-1) : -1;
+}
+
+/* mvendorid and marchid of one hart, from riscv_hwprobe() */
+static inline bool vdso_time_path_hwprobe(int cpu, uint64_t *mvendorid, uint64_t *marchid)
+{
+#if defined(__riscv) && defined(__NR_riscv_hwprobe)
+    struct { int64_t key; uint64_t value; } pairs[2] = {
+        { 0, 0 },               /* RISCV_HWPROBE_KEY_MVENDORID */
+        { 1, 0 },               /* RISCV_HWPROBE_KEY_MARCHID */
+    };
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (syscall(__NR_riscv_hwprobe, pairs, 2, sizeof(set), &set, 0) != 0 ||
+        pairs[0].key < 0 || pairs[1].key < 0)
+        return false;
+    *mvendorid = pairs[0].value;
+    *marchid = pairs[1].value;
+    return true;
+#else
+    (void)cpu;
+    (void)mvendorid;
+    (void)marchid;
+    return false;
+#endif
+}
+
+/* Cheapest counter read on the current hart, as the kernel's probe times it */
+static inline double vdso_time_path_read_cycles(void)
+{
+    uint64_t (*rd)(void) = vdso_calib.read_cycles;
+    uint64_t empty = UINT64_MAX, full = UINT64_MAX, acc = 0;
+
+    for (int i = 0; i < VDSO_TIME_PATH_READS; i++) {
+        uint64_t c0, c1;
+
+        c0 = rd();
+        c1 = rd();
+        if (c1 - c0 < empty)
+            empty = c1 - c0;
+
+        c0 = rd();
+        acc += vdso_bd_read_counter();
+        c1 = rd();
+        if (c1 - c0 < full)
+            full = c1 - c0;
+    }
+    vdso_bd_sink = acc;
+    return full > empty ? (double)(full - empty) : 0.0;
+}
+
+/*
+ * Fill @out with one entry per hart in our affinity mask, at most @max.
+ * Returns the number of entries; the affinity mask is restored.
+ */
+static inline int vdso_time_path_probe(struct vdso_time_path_hart *out, int max)
+{
+    vdso_time_path_fn fn = vdso_time_path_lookup();
+    cpu_set_t orig, one;
+    int n = 0;
+
+    if (sched_getaffinity(0, sizeof(orig), &orig) != 0)
+        return 0;
+
+    for (int cpu = 0; cpu < CPU_SETSIZE && n < max; cpu++) {
+        struct vdso_time_path_hart *h = &out[n];
+
+        if (!CPU_ISSET(cpu, &orig))
+            continue;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        if (sched_setaffinity(0, sizeof(one), &one) != 0)
+            continue;
+
+        memset(h, 0, sizeof(*h));
+        h->cpu = cpu;
+        h->read_cycles = vdso_time_path_read_cycles();
+        h->measured = h->read_cycles <= VDSO_TIME_PATH_NATIVE_CYCLES ?
+                      VDSO_TIME_CSR_NATIVE : VDSO_TIME_CSR_EMULATED;
+        h->kernel = fn ? fn(cpu) : -1;
+        h->has_ids = vdso_time_path_hwprobe(cpu, &h->mvendorid, &h->marchid);
+        n++;
+    }
+
+    sched_setaffinity(0, sizeof(orig), &orig);
+    return n;
+}
+
+/* The kernel's class where exported, else our own measurement */
+static inline enum vdso_time_csr vdso_time_path_class(const struct vdso_time_path_hart *h)
+{
+    if (h->kernel >= VDSO_TIME_CSR_UNKNOWN && h->kernel <= VDSO_TIME_CSR_NATIVE)
+        return (enum vdso_time_csr)h->kernel;
+    return h->measured;
+}
+
+#endif /* VDSO_TIME_PATH_H */
@@ -0,0 +1,129 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Portable timing backend: serialized counter reads plus a calibrated
+ * timebase, so that every figure can be reported in nanoseconds
+ *
+ * The programs time short code sequences with a raw counter because a
+ * clock_gettime() bracket would measure itself. The counter differs per
+ * architecture, and so does what it takes to keep the read in place:
+ *
+ *   riscv64   rdcycle      CSR reads execute in program order; an
+ *                          instruction fence would not add anything
+ *   x86_64    rdtsc        lfence on both sides, so the read neither
+ *                          starts early nor lets later work start first
+ *   aarch64   cntvct_el0   isb before the read; the generic timer, since
+ *                          the cycle counter is not user-readable by default
+ *   other     CLOCK_MONOTONIC_RAW in ns
+ *
+ * vdso_timing_init() hands the reader to vdso_calib.h, which measures its
+ * rate per hart against CLOCK_MONOTONIC_RAW, and makes vdso_results.h add
+ * an ns record next to every metric emitted in cycles. Results from
+ * different architectures then line up by name and carry their "arch".
+ */
+
+#ifndef VDSO_TIMING_H
+#define VDSO_TIMING_H
+
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "vdso_calib.h"
+#include "vdso_results.h"
+
+#if defined(__riscv)
+#define VDSO_TIMING_COUNTER "rdcycle"
+#elif defined(__x86_64__) || defined(__i386__)
+#define VDSO_TIMING_COUNTER "rdtsc"
+#elif defined(__aarch64__)
+#define VDSO_TIMING_COUNTER "cntvct_el0"
+#else
+#define VDSO_TIMING_COUNTER "clock_monotonic_raw"
+#endif
+
+static inline uint64_t vdso_timing_read(void)
+{
+    uint64_t v;
+#if defined(__riscv)
+    asm volatile("rdcycle %0" : "=r"(v) : : "memory");
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned int hi, lo;
+
+    asm volatile("lfence\n\trdtsc\n\tlfence" : "=a"(lo), "=d"(hi) : : "memory");
+    v = ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+    asm volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(v) : : "memory");
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    v = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+    return v;
+}
+
+/*
+ * vdso_timing_read() is a hardware counter that will not fault in user
+ * mode. Without one it is CLOCK_MONOTONIC_RAW, which user-space clock
+ * sources cannot extrapolate with.
+ */
+static inline bool vdso_timing_counter_usable(void)
+{
+#if defined(__riscv)
+    FILE *f = fopen("/proc/sys/kernel/perf_user_access", "r");
+    int v = 2;
+
+    /* Kernels without the knob leave rdcycle enabled */
+    if (f) {
+        if (fscanf(f, "%d", &v) != 1)
+            v = 0;
+        fclose(f);
+    }
+    return v == 2;
+#elif defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*
+ * The vDSO's clock_gettime entry, looked up at run time because it is not
+ * a link-time symbol and its name differs (arm64: __kernel_clock_gettime).
+ * Falls back to the C library's clock_gettime().
+ */
+static inline int (*vdso_timing_vdso_gettime(void))(clockid_t, struct timespec *)
+{
+    static const char *const names[] = { "__vdso_clock_gettime", "__kernel_clock_gettime" };
+    void *h = dlopen("linux-vdso.so.1", RTLD_NOW | RTLD_NOLOAD);
+
+    for (unsigned int i = 0; h && i < sizeof(names) / sizeof(names[0]); i++) {
+        void *fn = dlsym(h, names[i]);
+
+        if (fn)
+            return (int (*)(clockid_t, struct timespec *))fn;
+    }
+    return clock_gettime;
+}
+
+static inline double vdso_timing_to_ns(double cycles, int hart)
+{
+    return vdso_cycles_to_ns_hart(cycles, hart);
+}
+
+/* Calibrate the current hart and enable ns records; <0 on failure */
+static inline int vdso_timing_init(void)
+{
+    vdso_results.cycles_to_ns = vdso_timing_to_ns;
+    return vdso_calib_init(vdso_timing_read);
+}
+
+static inline void vdso_timing_print(const char *indent)
+{
+    printf("%s%s, counter %s\n", indent, vdso_results_arch(), VDSO_TIMING_COUNTER);
+    vdso_calib_print(indent);
+}
+
+#endif /* VDSO_TIMING_H */
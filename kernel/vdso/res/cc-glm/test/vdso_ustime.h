@@ -0,0 +1,322 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * User-space timestamp source with amortized CSR_TIME cost
+ *
+ * The vDSO time cache needs a patched kernel. This header does the same
+ * job in the application: each thread reads the clock through the normal
+ * clock_gettime() (one CSR_TIME trap) once per batch window and
+ * extrapolates with the cycle counter in between. It works on stock
+ * kernels, as long as the cycle counter is readable from user space
+ * (kernel.perf_user_access=2 on RISC-V).
+ *
+ * vdso_ustime_gettime() has the signature of clock_gettime(), so it can
+ * stand in for clock_gettime_vdso() anywhere; vdso_cache_test and
+ * vdso_cache_benchmark take --ustime to run all their tests against it.
+ *
+ * Calibration and drift bounds:
+ *   - The cycle rate is measured once against CLOCK_MONOTONIC_RAW and
+ *     then refined per thread from anchors of the same clock at least
+ *     VDSO_USTIME_RATE_NS apart, so that the noise of one clock read is
+ *     small against the interval.
+ *   - Every re-anchor compares the extrapolated value with the clock it
+ *     just read. An error above the bound (default 1us) halves the
+ *     thread's window; an error below a quarter of it doubles the window,
+ *     between VDSO_USTIME_MIN_WINDOW_NS and VDSO_USTIME_MAX_WINDOW_NS.
+ *   - A clock step (clock_settime, a large NTP adjustment) shows up at
+ *     the next re-anchor, i.e. at most one window late.
+ *   - Values returned to a thread never decrease within a window. Across
+ *     a re-anchor the monotonic clocks are held at the last value while
+ *     the clock catches up with an overshoot; REALTIME and TAI follow
+ *     backward steps larger than the error bound.
+ *
+ * Only the clocks that read the counter are extrapolated (see
+ * vdso_clocks.h); coarse and CPU-time clocks go straight to the backend.
+ * Cycle counters are per hart. After a migration the delta is either out
+ * of the window (and the thread re-anchors) or off by the skew between
+ * the harts' counters, as with the vDSO's own TLS cache.
+ */
+
+#ifndef VDSO_USTIME_H
+#define VDSO_USTIME_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "vdso_timing.h"
+
+#define VDSO_USTIME_MAX_ERROR_NS    1000        /* drift bound */
+#define VDSO_USTIME_WINDOW_NS       100000      /* initial batch window */
+#define VDSO_USTIME_MIN_WINDOW_NS   1000
+#define VDSO_USTIME_MAX_WINDOW_NS   1000000     /* also keeps delta * mult in 64 bits */
+#define VDSO_USTIME_CALIB_NS        2000000     /* startup calibration */
+#define VDSO_USTIME_RATE_NS         10000000    /* min anchor distance to refine the rate */
+#define VDSO_USTIME_RATE_TOL        0.05        /* larger rate changes are steps */
+#define VDSO_USTIME_BRACKET_TRIES   3           /* clock reads per anchor */
+#define VDSO_USTIME_NR_CLOCKS       12          /* clock IDs below CLOCK_TAI + 1 */
+
+struct vdso_ustime_stats {
+    uint64_t calls;
+    uint64_t anchors;           /* calls that read the clock */
+    uint64_t resyncs;           /* anchors whose error exceeded the bound */
+    double max_error_ns;        /* largest |extrapolated - read| seen */
+    double window_ns;           /* current batch window */
+};
+
+struct vdso_ustime_anchor {
+    uint64_t cycles;            /* counter at the clock read */
+    int64_t ns;                 /* clock value read */
+    int64_t last_ns;            /* last value returned */
+    uint64_t rate_cycles;       /* older anchor the rate is refined from */
+    int64_t rate_ns;
+};
+
+struct vdso_ustime_thread {
+    bool ready;
+    uint64_t mult;              /* ns per cycle, 32.32 fixed point */
+    double cycles_per_ns;
+    uint64_t window_cycles;
+    unsigned int rate_rejects;  /* consecutive rate estimates out of tolerance */
+    struct vdso_ustime_anchor a[VDSO_USTIME_NR_CLOCKS];
+    struct vdso_ustime_stats stats;
+};
+
+static struct {
+    pthread_once_t once;
+    pthread_mutex_t lock;       /* guards req and started */
+    bool started;               /* the once routine has taken req */
+    struct {
+        uint64_t (*read_cycles)(void);
+        int (*backend)(clockid_t, struct timespec *);
+        int64_t max_error_ns;
+    } req;                      /* vdso_ustime_init() arguments */
+    /* Written by the once routine only */
+    bool enabled;
+    uint64_t (*read_cycles)(void);
+    int (*backend)(clockid_t, struct timespec *);
+    double cycles_per_ns;       /* startup calibration */
+    int64_t max_error_ns;
+} vdso_ustime = { .once = PTHREAD_ONCE_INIT, .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static __thread struct vdso_ustime_thread vdso_ustime_tls;
+
+static inline int64_t vdso_ustime_ts_ns(const struct timespec *ts)
+{
+    return (int64_t)ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+static inline void vdso_ustime_calibrate(void)
+{
+    struct timespec t0, t1;
+    uint64_t c0, c1;
+
+    if (!vdso_ustime.read_cycles)
+        return;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t0);
+    c0 = vdso_ustime.read_cycles();
+    do {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &t1);
+        c1 = vdso_ustime.read_cycles();
+    } while (vdso_ustime_ts_ns(&t1) - vdso_ustime_ts_ns(&t0) < VDSO_USTIME_CALIB_NS);
+
+    if (c1 > c0) {
+        vdso_ustime.cycles_per_ns = (double)(c1 - c0) /
+                                    (vdso_ustime_ts_ns(&t1) - vdso_ustime_ts_ns(&t0));
+        vdso_ustime.enabled = true;
+    }
+}
+
+static inline void vdso_ustime_default_init(void)
+{
+    pthread_mutex_lock(&vdso_ustime.lock);
+    vdso_ustime.read_cycles = vdso_ustime.req.read_cycles;
+    vdso_ustime.backend = vdso_ustime.req.backend;
+    vdso_ustime.max_error_ns = vdso_ustime.req.max_error_ns;
+    vdso_ustime.started = true;
+    pthread_mutex_unlock(&vdso_ustime.lock);
+
+    if (!vdso_ustime.backend)
+        vdso_ustime.backend = clock_gettime;
+    if (!vdso_ustime.max_error_ns)
+        vdso_ustime.max_error_ns = VDSO_USTIME_MAX_ERROR_NS;
+    if (!vdso_ustime.read_cycles && vdso_timing_counter_usable())
+        vdso_ustime.read_cycles = vdso_timing_read;
+    vdso_ustime_calibrate();
+}
+
+/*
+ * Optional setup before the first call: the cycle reader (NULL for
+ * vdso_timing_read()), the clock read at each anchor (NULL for clock_gettime)
+ * and the drift bound (0 for VDSO_USTIME_MAX_ERROR_NS). Returns 0, or -1
+ * if no usable counter was found; calls then go to the backend. A call
+ * after setup already ran, from an earlier vdso_ustime_init() or a first
+ * vdso_ustime_gettime(), changes nothing and returns -1.
+ */
+static inline int vdso_ustime_init(uint64_t (*read_cycles)(void),
+                                   int (*backend)(clockid_t, struct timespec *),
+                                   int64_t max_error_ns)
+{
+    bool late;
+
+    pthread_mutex_lock(&vdso_ustime.lock);
+    late = vdso_ustime.started;
+    if (!late) {
+        vdso_ustime.req.read_cycles = read_cycles;
+        vdso_ustime.req.backend = backend;
+        vdso_ustime.req.max_error_ns = max_error_ns;
+    }
+    pthread_mutex_unlock(&vdso_ustime.lock);
+    if (late)
+        return -1;
+
+    pthread_once(&vdso_ustime.once, vdso_ustime_default_init);
+    return vdso_ustime.enabled ? 0 : -1;
+}
+
+static inline void vdso_ustime_set_rate(struct vdso_ustime_thread *t, double cycles_per_ns)
+{
+    t->cycles_per_ns = cycles_per_ns;
+    t->mult = (uint64_t)((double)(1ULL << 32) / cycles_per_ns);
+}
+
+static inline void vdso_ustime_set_window(struct vdso_ustime_thread *t, double ns)
+{
+    if (ns < VDSO_USTIME_MIN_WINDOW_NS)
+        ns = VDSO_USTIME_MIN_WINDOW_NS;
+    if (ns > VDSO_USTIME_MAX_WINDOW_NS)
+        ns = VDSO_USTIME_MAX_WINDOW_NS;
+    t->stats.window_ns = ns;
+    t->window_cycles = (uint64_t)(ns * t->cycles_per_ns);
+}
+
+static inline void vdso_ustime_split(int64_t ns, struct timespec *ts)
+{
+    ts->tv_sec = ns / 1000000000LL;
+    ts->tv_nsec = ns % 1000000000LL;
+    if (ts->tv_nsec < 0) {
+        ts->tv_sec--;
+        ts->tv_nsec += 1000000000LL;
+    }
+}
+
+/*
+ * Slow path: read the clock, check the last window's drift, re-anchor.
+ * The read is bracketed by the counter. A bracket wider than the drift
+ * bound (an interrupt, a preemption) is retried, and if it stays wide the
+ * value is returned without becoming an anchor.
+ */
+static inline int vdso_ustime_anchor(struct vdso_ustime_thread *t, clockid_t clk,
+                                     struct timespec *ts)
+{
+    struct vdso_ustime_anchor *a = &t->a[clk];
+    bool monotonic = clk != CLOCK_REALTIME && clk != CLOCK_TAI;
+    uint64_t c0, c1, mid, dc, bracket;
+    int64_t ns, dn;
+    int ret, tries = 0;
+
+    bracket = (uint64_t)(vdso_ustime.max_error_ns * t->cycles_per_ns);
+    do {
+        c0 = vdso_ustime.read_cycles();
+        ret = vdso_ustime.backend(clk, ts);
+        if (ret)
+            return ret;
+        c1 = vdso_ustime.read_cycles();
+    } while (c1 - c0 > bracket && ++tries < VDSO_USTIME_BRACKET_TRIES);
+
+    ns = vdso_ustime_ts_ns(ts);
+    t->stats.anchors++;
+    if (c1 - c0 > bracket) {
+        a->cycles = 0;
+        goto out;
+    }
+    mid = c0 + (c1 - c0) / 2;
+
+    dc = mid - a->cycles;
+    if (a->cycles && dc < 2 * t->window_cycles) {
+        int64_t predicted = a->ns + (int64_t)((dc * t->mult) >> 32);
+        double err = (double)(predicted > ns ? predicted - ns : ns - predicted);
+
+        if (err > t->stats.max_error_ns)
+            t->stats.max_error_ns = err;
+        if (err > vdso_ustime.max_error_ns) {
+            t->stats.resyncs++;
+            vdso_ustime_set_window(t, t->stats.window_ns / 2);
+        } else if (err * 4 < vdso_ustime.max_error_ns) {
+            vdso_ustime_set_window(t, t->stats.window_ns * 2);
+        }
+    }
+    dn = ns - a->rate_ns;
+    if (!a->rate_cycles || mid <= a->rate_cycles || dn < 0) {
+        a->rate_cycles = mid;
+        a->rate_ns = ns;
+    } else if (dn >= VDSO_USTIME_RATE_NS) {
+        double rate = (double)(mid - a->rate_cycles) / dn;
+
+        if ((rate > t->cycles_per_ns * (1 - VDSO_USTIME_RATE_TOL) &&
+             rate < t->cycles_per_ns * (1 + VDSO_USTIME_RATE_TOL)) ||
+            ++t->rate_rejects >= 3) {
+            /* Three in a row is a hart with another rate, not a step */
+            vdso_ustime_set_rate(t, rate);
+            vdso_ustime_set_window(t, t->stats.window_ns);
+            t->rate_rejects = 0;
+        }
+        a->rate_cycles = mid;
+        a->rate_ns = ns;
+    }
+
+    a->cycles = mid;
+    a->ns = ns;
+out:
+    if (ns < a->last_ns && (monotonic || a->last_ns - ns <= vdso_ustime.max_error_ns)) {
+        vdso_ustime_split(a->last_ns, ts);
+        return 0;
+    }
+    a->last_ns = ns;
+    return 0;
+}
+
+/* clock_gettime() with at most one clock read per batch window per thread */
+static inline int vdso_ustime_gettime(clockid_t clk, struct timespec *ts)
+{
+    struct vdso_ustime_thread *t = &vdso_ustime_tls;
+    struct vdso_ustime_anchor *a;
+    uint64_t now, dc;
+    int64_t ns;
+
+    pthread_once(&vdso_ustime.once, vdso_ustime_default_init);
+    if (!vdso_ustime.enabled || clk < 0 || clk >= VDSO_USTIME_NR_CLOCKS ||
+        (clk != CLOCK_REALTIME && clk != CLOCK_MONOTONIC && clk != CLOCK_MONOTONIC_RAW &&
+         clk != CLOCK_BOOTTIME && clk != CLOCK_TAI))
+        return vdso_ustime.backend(clk, ts);
+
+    if (!t->ready) {
+        vdso_ustime_set_rate(t, vdso_ustime.cycles_per_ns);
+        vdso_ustime_set_window(t, VDSO_USTIME_WINDOW_NS);
+        t->ready = true;
+    }
+
+    t->stats.calls++;
+    a = &t->a[clk];
+    now = vdso_ustime.read_cycles();
+    dc = now - a->cycles;
+    if (!a->cycles || dc >= t->window_cycles)
+        return vdso_ustime_anchor(t, clk, ts);
+
+    ns = a->ns + (int64_t)((dc * t->mult) >> 32);
+    if (ns < a->last_ns)
+        ns = a->last_ns;
+    a->last_ns = ns;
+    vdso_ustime_split(ns, ts);
+    return 0;
+}
+
+/* Counters of the calling thread */
+static inline void vdso_ustime_get_stats(struct vdso_ustime_stats *s)
+{
+    *s = vdso_ustime_tls.stats;
+}
+
+#endif /* VDSO_USTIME_H */
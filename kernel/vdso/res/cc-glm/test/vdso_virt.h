@@ -0,0 +1,203 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Guest detection and time-read costs under virtualization
+ *
+ * In a KVM guest, rdtime reads the time CSR in VS-mode. Without a
+ * readable time CSR in hardware it traps to M-mode firmware, which
+ * redirects it to the hypervisor to add htimedelta: an extra exit on top
+ * of the bare-metal trap. The time cache saves that whole path on a hit.
+ *
+ * Detection (RISC-V): a QEMU "riscv-virtio" or kvmtool "linux,dummy-virt"
+ * device tree means a virtual machine. KVM passes the host's mvendorid
+ * through while QEMU TCG reports 0, which tells the two apart. On x86 the
+ * cpuinfo "hypervisor" flag is used. The DMI vendor names the hypervisor
+ * where firmware provides it.
+ *
+ * Costs are timed against CLOCK_MONOTONIC_RAW over batches rather than
+ * with rdcycle, which guests often cannot read from user space.
+ */
+
+#ifndef VDSO_VIRT_H
+#define VDSO_VIRT_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vdso_breakdown.h"
+
+#define VDSO_VIRT_BATCH     1000    /* ops per timed batch */
+#define VDSO_VIRT_SAMPLES   200     /* batches per op, median kept */
+
+struct vdso_virt {
+    bool guest;
+    char kind[16];              /* "bare-metal", "kvm", "qemu-tcg", "vm" */
+    char vendor[64];            /* DMI sys_vendor, or "" */
+    bool sstc;                  /* RISC-V: Sstc in the ISA string */
+    bool h_ext;                 /* RISC-V: H extension, i.e. we could host */
+};
+
+/* First line of @path without the newline; false if unreadable */
+static inline bool vdso_virt_read_line(const char *path, char *buf, size_t len)
+{
+    FILE *f = fopen(path, "r");
+    bool ok;
+
+    if (!f)
+        return false;
+    ok = fgets(buf, (int)len, f) != NULL;
+    fclose(f);
+    if (ok)
+        buf[strcspn(buf, "\n")] = '\0';
+    return ok;
+}
+
+/* Value of the first "@key<tab>: value" line of /proc/cpuinfo */
+static inline bool vdso_virt_cpuinfo(const char *key, char *buf, size_t len)
+{
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    char line[4096];
+    size_t n = strlen(key);
+    bool found = false;
+
+    if (!f)
+        return false;
+    while (!found && fgets(line, sizeof(line), f)) {
+        char *p = line + n;
+
+        if (strncmp(line, key, n) != 0 || (*p != ' ' && *p != '\t' && *p != ':'))
+            continue;
+        p = strchr(line, ':');
+        if (!p)
+            continue;
+        p += strspn(p + 1, " \t") + 1;
+        p[strcspn(p, "\n")] = '\0';
+        snprintf(buf, len, "%s", p);
+        found = true;
+    }
+    fclose(f);
+    return found;
+}
+
+/* The DT "compatible" property is a list of NUL-separated strings */
+static inline bool vdso_virt_dt_compatible(const char *compat)
+{
+    FILE *f = fopen("/proc/device-tree/compatible", "r");
+    char buf[512];
+    size_t n, off = 0;
+
+    if (!f)
+        return false;
+    n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    while (off < n) {
+        if (strcmp(buf + off, compat) == 0)
+            return true;
+        off += strlen(buf + off) + 1;
+    }
+    return false;
+}
+
+static inline void vdso_virt_detect(struct vdso_virt *v)
+{
+    char buf[4096];
+
+    memset(v, 0, sizeof(*v));
+    snprintf(v->kind, sizeof(v->kind), "bare-metal");
+    vdso_virt_read_line("/sys/class/dmi/id/sys_vendor", v->vendor, sizeof(v->vendor));
+
+#if defined(__riscv)
+    if (vdso_virt_cpuinfo("isa", buf, sizeof(buf))) {
+        size_t base = strcspn(buf, "_");
+
+        v->sstc = strstr(buf, "_sstc") != NULL;
+        /* Single-letter extensions follow "rv64"/"rv32" up to the first '_' */
+        v->h_ext = base > 4 && memchr(buf + 4, 'h', base - 4) != NULL;
+    }
+    if (vdso_virt_dt_compatible("riscv-virtio") ||
+        vdso_virt_dt_compatible("linux,dummy-virt")) {
+        bool passthrough = vdso_virt_cpuinfo("mvendorid", buf, sizeof(buf)) &&
+                           strtoull(buf, NULL, 0) != 0;
+
+        v->guest = true;
+        if (vdso_virt_dt_compatible("linux,dummy-virt") || passthrough)
+            snprintf(v->kind, sizeof(v->kind), "kvm");
+        else
+            snprintf(v->kind, sizeof(v->kind), "qemu-tcg");
+    }
+#else
+    if (vdso_virt_cpuinfo("flags", buf, sizeof(buf)) && strstr(buf, " hypervisor")) {
+        v->guest = true;
+        snprintf(v->kind, sizeof(v->kind), "vm");
+    }
+#endif
+    if (!v->guest && (strstr(v->vendor, "QEMU") || strstr(v->vendor, "KVM"))) {
+        v->guest = true;
+        snprintf(v->kind, sizeof(v->kind), "vm");
+    }
+}
+
+static inline int vdso_virt_cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * Median ns per op of @op: 0 = hardware counter read, 1 = @gettime,
+ * 2 = @gettime plus one counter read (a forced miss on a cached kernel).
+ */
+static inline double vdso_virt_time(int op, int (*gettime)(clockid_t, struct timespec *))
+{
+    static double t[VDSO_VIRT_SAMPLES];
+    struct timespec ts = { 0 };
+    uint64_t acc = 0;
+
+    for (int s = 0; s < VDSO_VIRT_SAMPLES; s++) {
+        uint64_t t0 = vdso_calib_raw_ns(), t1;
+
+        for (int i = 0; i < VDSO_VIRT_BATCH; i++) {
+            if (op != 0)
+                gettime(CLOCK_MONOTONIC, &ts);
+            if (op != 1)
+                acc += vdso_bd_read_counter();
+        }
+        t1 = vdso_calib_raw_ns();
+        t[s] = (double)(t1 - t0) / VDSO_VIRT_BATCH;
+    }
+    vdso_bd_sink = acc + ts.tv_nsec;
+    qsort(t, VDSO_VIRT_SAMPLES, sizeof(t[0]), vdso_virt_cmp);
+    return t[VDSO_VIRT_SAMPLES / 2];
+}
+
+/*
+ * Value of result @name ("scope.slug") from a JSON lines file written by
+ * --json on another machine, NAN if absent. Last occurrence wins.
+ */
+static inline double vdso_virt_baseline(const char *path, const char *name)
+{
+    FILE *f = fopen(path, "r");
+    char line[1024], key[128];
+    double v = NAN;
+
+    if (!f)
+        return NAN;
+    snprintf(key, sizeof(key), "\"name\":\"%s\"", name);
+    while (fgets(line, sizeof(line), f)) {
+        char *p;
+
+        if (!strstr(line, key) || !(p = strstr(line, "\"value\":")))
+            continue;
+        v = strtod(p + strlen("\"value\":"), NULL);
+    }
+    fclose(f);
+    return v;
+}
+
+#endif /* VDSO_VIRT_H */